@@ -11,26 +11,188 @@
 #include <csignal>
 
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 
 #include <libpq-fe.h>
 
 #include <queue>
 #include <condition_variable>
+#include <future>
+#include <memory>
+#include <string_view>
 
 #include <fstream>
 
 #define BACKEND_PORT 7000
+#define BACKEND_BINARY_PORT 7001
 #define BUFFER_SIZE 10240
+#define MSET_ROWS_PER_STATEMENT 1000
+#define MAX_KEYS_PAGE 10000
+// DB workers, each with its own PGconn. Requests from every frontend connection share them.
+#define DEFAULT_NUM_THREADS 8
 
+// Binary protocol, spoken on BACKEND_BINARY_PORT by frontends started with --backend-binary. Every
+// message is a 16-byte header followed by the raw key and value bytes:
+//   [0] magic  [1] opcode  [2..3] flags (request) or status code (response)
+//   [4..7] request id, echoed back  [8..11] key length  [12..15] value length   (little-endian)
+// MSET carries its pairs in the value as repeated {u32 key length, u32 value length, key, value}.
+// KEYS sends the key to start after (with BINARY_FLAG_AFTER) and a u32 page size as its value, and
+// gets back repeated {u32 length, key}. Every other response carries the value or error text.
+#define BINARY_MAGIC 0xB5
+#define BINARY_HEADER_SIZE 16
+#define BINARY_MAX_FRAME (64 * 1024 * 1024)
+#define BINARY_FLAG_AFTER 1
+
+enum BinaryOp : uint8_t { OP_GET = 1, OP_SET = 2, OP_DELETE = 3, OP_MSET = 4, OP_KEYS = 5, OP_PING = 6 };
+
+uint32_t get32(const char* p)
+{
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return u[0] | (u[1] << 8) | (u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+void put32(std::string& out, uint32_t v)
+{
+    char b[4] = {(char)v, (char)(v >> 8), (char)(v >> 16), (char)(v >> 24)};
+    out.append(b, 4);
+}
 
 const std::string db_NAME = "KEY_VALUE";
 const std::string table_NAME = "KV_Store";
+const std::string db_CONNINFO = "dbname=" + db_NAME + " user=dev password='123456' hostaddr=127.0.0.1 port=5432";
 
 
 volatile sig_atomic_t g_shutdown_flag = 0;
 
+std::vector<int> g_active_sockets;
+std::mutex g_active_socket_list_mutex;
+// Reader threads are detached; shutdown waits on this count instead of joining them.
+int g_active_readers = 0;
+std::condition_variable g_readers_done;
+
+template <typename T>
+class ThreadSafeQueue
+{
+    private:
+        std::queue<T> m_queue;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        bool m_stop = false;
+
+    public:
+    
+        void push(T task)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push(std::move(task));
+            m_cond.notify_one();
+        }
+
+        // False once the queue is stopped and empty.
+        bool pop(T& task)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(m_stop == false && m_queue.empty())
+            {
+                m_cond.wait(lock);
+            }            
+            
+            if(m_stop && m_queue.empty())
+            {
+                return false;
+            }
+            task = std::move(m_queue.front());
+            m_queue.pop();
+            return true;
+        }
+
+        void stop()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+
+            m_cond.notify_all();
+        }
+
+};
+
+// A frontend connection. Several DB workers may answer requests from it at once, so writes take
+// send_mutex. The socket is closed when the reader and the last pending request are done with it.
+struct FrontendConnection
+{
+    int fd;
+    std::mutex send_mutex;
+    // Set under send_mutex once a write fails: the frontend is gone or reset the connection, and a reply
+    // cut off midway leaves the stream unusable, so nothing more is written to it.
+    bool dead = false;
+
+    explicit FrontendConnection(int sock) : fd(sock) {}
+    ~FrontendConnection() { close(fd); }
+
+    // Caller holds send_mutex. Shutting the socket down also ends the reader.
+    void markDead()
+    {
+        if (dead) return;
+        dead = true;
+        std::cerr << "[WARN] Write to Frontend connection failed. Closing it." << std::endl;
+        shutdown(fd, SHUT_RDWR);
+    }
+};
+
+struct DbRequest
+{
+    std::shared_ptr<FrontendConnection> conn;
+    bool malformed = false;
+    bool is_post = false;
+    bool keep_alive = true;
+    std::string path;
+    std::string query;
+    std::string body;
+    // Echoed back so the frontend can match responses that complete out of order. Requests without
+    // one are answered in the order they arrived: the reader waits for `answered` before the next.
+    std::string request_id;
+    std::shared_ptr<std::promise<void>> answered;
+
+    // Binary requests keep their whole frame; key() and value() point into it.
+    bool binary = false;
+    std::string frame;
+
+    uint8_t opcode() const { return frame[1]; }
+    uint16_t flags() const { return (unsigned char)frame[2] | ((unsigned char)frame[3] << 8); }
+    std::string_view key() const { return std::string_view(frame).substr(BINARY_HEADER_SIZE, get32(&frame[8])); }
+    std::string_view value() const { return std::string_view(frame).substr(BINARY_HEADER_SIZE + get32(&frame[8]), get32(&frame[12])); }
+};
+
+void add_socket(int sock)
+{
+    std::lock_guard<std::mutex> lock(g_active_socket_list_mutex);
+    g_active_sockets.push_back(sock);
+}
+
+void reader_exited()
+{
+    std::lock_guard<std::mutex> lock(g_active_socket_list_mutex);
+    if(--g_active_readers == 0) g_readers_done.notify_all();
+}
+
+void remove_socket(int sock)
+{
+    std::lock_guard<std::mutex> lock(g_active_socket_list_mutex);
+    for(size_t i = 0; i < g_active_sockets.size(); i++)
+    {
+        if(g_active_sockets[i] == sock)
+        {
+            g_active_sockets[i] = g_active_sockets.back();
+            g_active_sockets.pop_back();
+            break;
+        }
+    }
+}
+
 std::string urlDecode(const std::string &str)
 {
     std::string decoded;
@@ -60,6 +222,24 @@ std::string urlDecode(const std::string &str)
     return decoded;
 }
 
+std::string urlEncode(const std::string &str)
+{
+    std::string encoded;
+    for(char c : str)
+    {
+        if(isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~')
+            encoded += c;
+        else
+        {
+            encoded += '%';
+            char hex[3];
+            sprintf(hex, "%02X", static_cast<unsigned char>(c));
+            encoded += hex;
+        }
+    }
+    return encoded;
+}
+
 void create_Key_Value_Table(PGconn* conn)
 {
     std::string sql_command = "CREATE TABLE IF NOT EXISTS " + table_NAME +
@@ -76,40 +256,39 @@ void create_Key_Value_Table(PGconn* conn)
     PQclear(res);
 }
 
-std::string handle_db_set(const std::string& query, std::string& http_status, PGconn* conn)
+// Keys and values are passed with explicit lengths in binary format (for TEXT that is the raw bytes),
+// so they can point straight into a request buffer without being copied or NUL-terminated.
+PGresult* exec_with_views(PGconn* conn, const std::string& sql_command, const std::vector<std::string_view>& params)
 {
-    size_t keyPos = query.find("key=");
-    size_t valPos = query.find("value=");
-
-    if(keyPos == std::string::npos || valPos == std::string::npos)
+    std::vector<const char*> paramValues;
+    std::vector<int> paramLengths;
+    std::vector<int> paramFormats(params.size(), 1);
+    for (std::string_view p : params)
     {
-        http_status = "400 Bad Request";
-        return "Error missing 'key' or 'value' parameter for /db_set.";
+        paramValues.push_back(p.data() != nullptr ? p.data() : "");
+        paramLengths.push_back(p.size());
     }
 
-    keyPos += 4;
-    valPos += 6;
-
-    std::string key = urlDecode(query.substr(keyPos, query.find("&", keyPos) - keyPos));
-    std::string value = urlDecode(query.substr(valPos));
+    return PQexecParams
+    (
+        conn,
+        sql_command.c_str(),
+        params.size(),
+        NULL,
+        paramValues.data(),
+        paramLengths.data(),
+        paramFormats.data(),
+        0
+    );
+}
 
+std::string db_set(std::string_view key, std::string_view value, std::string& http_status, PGconn* conn)
+{
     std::string sql_command =
         "INSERT INTO " + table_NAME + " (key, value) VALUES ($1, $2) "
         "ON CONFLICT (key) DO UPDATE SET value = EXCLUDED.value";
 
-    const char *paramValues[2] = {key.c_str(), value.c_str()};
-    const Oid paramTypes[2] = {0, 0}; 
-    
-    PGresult *res = PQexecParams
-    (
-        conn,
-        sql_command.c_str(),
-        2,
-        paramTypes,
-        paramValues,
-        NULL, 
-        NULL, 
-        0);
+    PGresult *res = exec_with_views(conn, sql_command, {key, value});
 
     if (PQresultStatus(res) != PGRES_COMMAND_OK)
     {
@@ -124,34 +303,80 @@ std::string handle_db_set(const std::string& query, std::string& http_status, PG
     return "OK";
 }
 
-std::string handle_db_get(const std::string& query, std::string& http_status, PGconn* conn)
+// Batched upsert for write-back flushes. Pairs are deduplicated first (the last one wins), since a single
+// INSERT ... ON CONFLICT cannot update the same row twice, then written MSET_ROWS_PER_STATEMENT rows per
+// statement inside one transaction.
+std::string db_mset(const std::vector<std::pair<std::string_view, std::string_view>>& pairs, std::string& http_status, PGconn* conn)
 {
-    size_t keyPos = query.find("key=");
-    if(keyPos == std::string::npos)
+    std::map<std::string_view, std::string_view> rows;
+    for (const auto& pair : pairs)
+    {
+        rows[pair.first] = pair.second;
+    }
+
+    if(rows.empty())
     {
         http_status = "400 Bad Request";
-        return "Error missing 'key' parameter for /db_get.";
+        return "Error: no key/value pairs for MSET.";
     }
 
-    keyPos += 4;
-    std::string key = urlDecode(query.substr(keyPos));
+    PGresult *begin = PQexec(conn, "BEGIN");
+    if (PQresultStatus(begin) != PGRES_COMMAND_OK)
+    {
+        std::cerr << "SQL command failed (MSET BEGIN): " << PQerrorMessage(conn) << std::endl;
+        http_status = "500 Internal Server Error";
+        PQclear(begin);
+        return "ERROR: Database batch write failed.";
+    }
+    PQclear(begin);
+
+    auto it = rows.begin();
+    while(it != rows.end())
+    {
+        std::string sql_command = "INSERT INTO " + table_NAME + " (key, value) VALUES ";
+        std::vector<std::string_view> params;
+        for(int n = 0; it != rows.end() && n < MSET_ROWS_PER_STATEMENT; ++it, n++)
+        {
+            if(n > 0) sql_command += ", ";
+            sql_command += "($" + std::to_string(params.size() + 1) + ", $" + std::to_string(params.size() + 2) + ")";
+            params.push_back(it->first);
+            params.push_back(it->second);
+        }
+        sql_command += " ON CONFLICT (key) DO UPDATE SET value = EXCLUDED.value";
 
+        PGresult *res = exec_with_views(conn, sql_command, params);
+
+        if (PQresultStatus(res) != PGRES_COMMAND_OK)
+        {
+            std::cerr << "SQL command failed (MSET): " << PQerrorMessage(conn) << std::endl;
+            http_status = "500 Internal Server Error";
+            PQclear(res);
+            PQclear(PQexec(conn, "ROLLBACK"));
+            return "ERROR: Database batch write failed.";
+        }
+        PQclear(res);
+    }
+
+    PGresult *res = PQexec(conn, "COMMIT");
+    if (PQresultStatus(res) != PGRES_COMMAND_OK)
+    {
+        std::cerr << "SQL command failed (MSET COMMIT): " << PQerrorMessage(conn) << std::endl;
+        http_status = "500 Internal Server Error";
+        PQclear(res);
+        return "ERROR: Database batch write failed.";
+    }
+    PQclear(res);
+
+    std::cout << "[DB LOG] MSET " << rows.size() << " keys successful." << std::endl;
+    return "OK";
+}
+
+std::string db_get(std::string_view key, std::string& http_status, PGconn* conn)
+{
     std::string sql_command =
         "SELECT value FROM " + table_NAME + " WHERE key = $1";
-    const char *paramValues[1] = {key.c_str()};
-    const Oid paramTypes[1] = {0};
 
-    PGresult *res = PQexecParams
-    (
-        conn,
-        sql_command.c_str(),
-        1,
-        paramTypes,
-        paramValues,
-        NULL,
-        NULL,
-        0
-    );
+    PGresult *res = exec_with_views(conn, sql_command, {key});
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK)
     {
@@ -163,7 +388,7 @@ std::string handle_db_get(const std::string& query, std::string& http_status, PG
     
     if(PQntuples(res) > 0)
     {
-        std::string value_from_db(PQgetvalue(res, 0, 0));
+        std::string value_from_db(PQgetvalue(res, 0, 0), PQgetlength(res, 0, 0));
         std::cout << "[DB LOG] GET Key " << key << " found." << std::endl;
         PQclear(res);
         return value_from_db;
@@ -177,33 +402,39 @@ std::string handle_db_get(const std::string& query, std::string& http_status, PG
     }
 }
 
-std::string handle_db_delete(const std::string& query, std::string& http_status, PGconn* conn)
+// One page of the keys in the table, in key order, for the frontend to build its key filter from. The
+// page starts after `after` when has_after is set; an empty page means there are no more keys.
+std::string db_keys(bool has_after, std::string_view after, long limit, std::vector<std::string>& keys, std::string& http_status, PGconn* conn)
 {
-    size_t keyPos = query.find("key=");
-    if(keyPos == std::string::npos)
+    if(limit <= 0 || limit > MAX_KEYS_PAGE) limit = MAX_KEYS_PAGE;
+
+    std::string sql_command = "SELECT key FROM " + table_NAME + (has_after ? " WHERE key > $1" : "") + " ORDER BY key LIMIT " + std::to_string(limit);
+    std::vector<std::string_view> params;
+    if(has_after) params.push_back(after);
+    PGresult *res = exec_with_views(conn, sql_command, params);
+
+    if (PQresultStatus(res) != PGRES_TUPLES_OK)
     {
-        http_status = "400 Bad Request";
-        return "Error missing 'key' parameter for /db_delete.";
+        std::cerr << "SQL command failed (KEYS): " << PQerrorMessage(conn) << std::endl;
+        http_status = "500 Internal Server Error";
+        PQclear(res);
+        return "ERROR: Database key scan failed.";
     }
-    keyPos += 4;    
-    std::string key = urlDecode(query.substr(keyPos));
-    
+
+    for(int i = 0; i < PQntuples(res); i++)
+    {
+        keys.emplace_back(PQgetvalue(res, i, 0), PQgetlength(res, i, 0));
+    }
+    PQclear(res);
+    return "";
+}
+
+std::string db_delete(std::string_view key, std::string& http_status, PGconn* conn)
+{
     std::string sql_command = 
         "DELETE FROM " + table_NAME + " WHERE key = $1";
-    const char* paramValues[1] = {key.c_str()};
-    const Oid paramTypes[1] = {0};
 
-    PGresult* res = PQexecParams
-    (
-        conn,
-        sql_command.c_str(),
-        1,
-        paramTypes,
-        paramValues,
-        NULL,
-        NULL,
-        0
-    );
+    PGresult* res = exec_with_views(conn, sql_command, {key});
 
     if (PQresultStatus(res) != PGRES_COMMAND_OK)
     {
@@ -232,164 +463,612 @@ std::string handle_db_delete(const std::string& query, std::string& http_status,
     }
 }
 
+// Health check for the frontend's connection pool: answers only if this worker's DB connection is usable.
+std::string db_ping(std::string& http_status, PGconn* conn)
+{
+    if(PQstatus(conn) != CONNECTION_OK) PQreset(conn);
+    if(PQstatus(conn) != CONNECTION_OK)
+    {
+        http_status = "503 Service Unavailable";
+        return "ERROR: Database connection lost.";
+    }
+    return "PONG";
+}
+
+std::string handle_db_set(const std::string& query, std::string& http_status, PGconn* conn)
+{
+    size_t keyPos = query.find("key=");
+    size_t valPos = query.find("value=");
+
+    if(keyPos == std::string::npos || valPos == std::string::npos)
+    {
+        http_status = "400 Bad Request";
+        return "Error missing 'key' or 'value' parameter for /db_set.";
+    }
+
+    keyPos += 4;
+    valPos += 6;
+
+    std::string key = urlDecode(query.substr(keyPos, query.find("&", keyPos) - keyPos));
+    std::string value = urlDecode(query.substr(valPos));
+    return db_set(key, value, http_status, conn);
+}
+
+// The body is form-encoded: key=value&key=value...
+std::string handle_db_mset(const std::string& body, std::string& http_status, PGconn* conn)
+{
+    std::vector<std::string> decoded;
+    size_t pos = 0;
+    while(pos < body.length())
+    {
+        size_t end = body.find('&', pos);
+        if(end == std::string::npos) end = body.length();
+        size_t eq = body.find('=', pos);
+        if(eq == std::string::npos || eq > end)
+        {
+            http_status = "400 Bad Request";
+            return "Error: malformed key=value pair in /db_mset body.";
+        }
+        decoded.push_back(urlDecode(body.substr(pos, eq - pos)));
+        decoded.push_back(urlDecode(body.substr(eq + 1, end - eq - 1)));
+        pos = end + 1;
+    }
+
+    std::vector<std::pair<std::string_view, std::string_view>> pairs;
+    for(size_t i = 0; i + 1 < decoded.size(); i += 2)
+    {
+        pairs.emplace_back(decoded[i], decoded[i + 1]);
+    }
+    return db_mset(pairs, http_status, conn);
+}
+
+std::string handle_db_get(const std::string& query, std::string& http_status, PGconn* conn)
+{
+    size_t keyPos = query.find("key=");
+    if(keyPos == std::string::npos)
+    {
+        http_status = "400 Bad Request";
+        return "Error missing 'key' parameter for /db_get.";
+    }
+
+    keyPos += 4;
+    return db_get(urlDecode(query.substr(keyPos)), http_status, conn);
+}
+
+// The body holds one URL-encoded key per line; the next page starts after the last key returned (after=<key>).
+std::string handle_db_keys(const std::string& query, std::string& http_status, PGconn* conn)
+{
+    long limit = MAX_KEYS_PAGE;
+    size_t limitPos = query.find("limit=");
+    if(limitPos != std::string::npos)
+    {
+        limit = strtol(query.c_str() + limitPos + 6, nullptr, 10);
+    }
+
+    size_t afterPos = query.find("after=");
+    std::string after;
+    if(afterPos != std::string::npos)
+    {
+        afterPos += 6;
+        after = urlDecode(query.substr(afterPos, query.find('&', afterPos) - afterPos));
+    }
+
+    std::vector<std::string> keys;
+    std::string error = db_keys(afterPos != std::string::npos, after, limit, keys, http_status, conn);
+    if(!error.empty()) return error;
+
+    std::string body;
+    for(const std::string& key : keys)
+    {
+        body += urlEncode(key);
+        body += '\n';
+    }
+    return body;
+}
+
+std::string handle_db_delete(const std::string& query, std::string& http_status, PGconn* conn)
+{
+    size_t keyPos = query.find("key=");
+    if(keyPos == std::string::npos)
+    {
+        http_status = "400 Bad Request";
+        return "Error missing 'key' parameter for /db_delete.";
+    }
+    keyPos += 4;    
+    return db_delete(urlDecode(query.substr(keyPos)), http_status, conn);
+}
+
 void signal_handler(int signum)
 {
     std::cout << "\n[INFO] SIGINT (Ctrl+C) received. Initiating shutdown..." << std::endl;
     g_shutdown_flag = 1;
 }
 
-void handle_client(int new_socket, PGconn* conn)
+std::string dispatch(const DbRequest& req, std::string& http_status, PGconn* conn)
 {
+    if (req.malformed)
+    {
+        http_status = "400 Bad Request";
+        return "Error: Malformed Request";
+    }
+    if (req.path == "db_set")
+        return handle_db_set(req.query, http_status, conn);
+    if (req.path == "db_get")
+        return handle_db_get(req.query, http_status, conn);
+    if (req.path == "db_delete")
+        return handle_db_delete(req.query, http_status, conn);
+    if (req.path == "db_mset" && req.is_post)
+        return handle_db_mset(req.body, http_status, conn);
+    if (req.path == "db_keys")
+        return handle_db_keys(req.query, http_status, conn);
+    if (req.path == "db_ping")
+        return db_ping(http_status, conn);
+
+    http_status = "404 Not Found";
+    return "Internal API: /db_set, /db_get, /db_delete, /db_keys, /db_ping, POST /db_mset\n";
+}
+
+void send_response(const DbRequest& req, const std::string& http_status, const std::string& response_body)
+{
+    std::string http_response = "HTTP/1.1 " + http_status + "\r\n";
+    http_response += "Content-Type: text/plain\r\n";
+    if (!req.request_id.empty()) http_response += "X-Request-Id: " + req.request_id + "\r\n";
+    http_response += "Content-Length: " + std::to_string(response_body.length()) + "\r\n";
+    http_response += (req.keep_alive) ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    http_response += "\r\n";
+    http_response += response_body;
+
+    std::lock_guard<std::mutex> lock(req.conn->send_mutex);
+    size_t sent = 0;
+    while (!req.conn->dead && sent < http_response.length())
+    {
+        ssize_t n = send(req.conn->fd, http_response.c_str() + sent, http_response.length() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) 
+        {
+            req.conn->markDead();
+            break;
+        }
+        sent += n;
+    }
+}
+
+// Reads requests off one frontend connection, which may send many before reading any response, and
+// queues them for the DB workers.
+void handle_client(std::shared_ptr<FrontendConnection> conn, ThreadSafeQueue<DbRequest>& queue)
+{
+    char buffer[BUFFER_SIZE];
+    std::string stream;
+    // How far the search for the end of the next request's headers got, so a large /db_mset body is not
+    // searched again from the start after every read.
+    size_t scanned = 0;
+
     while (true)
     {
-        char buffer[BUFFER_SIZE] = {0};
-        int bytes_read = read(new_socket, buffer, BUFFER_SIZE);
+        size_t header_end = stream.find("\r\n\r\n", std::max<size_t>(scanned, 3) - 3);
+        scanned = (header_end == std::string::npos) ? stream.length() : header_end;
+        // A POST body (/db_mset) can be far larger than one read: keep reading until Content-Length bytes arrived.
+        size_t content_length = 0;
+        if (header_end != std::string::npos)
+        {
+            size_t clPos = std::string_view(stream).substr(0, header_end).find("Content-Length: ");
+            if (clPos != std::string_view::npos)
+            {
+                content_length = strtoul(stream.c_str() + clPos + 16, nullptr, 10);
+            }
+        }
+        // Same bound as a binary frame, so a bad Content-Length or a header that never ends cannot grow the buffer without limit.
+        if (content_length > BINARY_MAX_FRAME || (header_end == std::string::npos && stream.length() > BINARY_MAX_FRAME))
+        {
+            std::cerr << "[ERROR] Oversized request from Frontend. Closing connection." << std::endl;
+            break;
+        }
+        if (header_end == std::string::npos || stream.length() < header_end + 4 + content_length)
+        {
+            int bytes_read = read(conn->fd, buffer, BUFFER_SIZE);
+            if (bytes_read <= 0) break;
+            stream.append(buffer, bytes_read);
+            continue;
+        }
 
-        if (bytes_read <= 0) break;
+        std::string request = stream.substr(0, header_end + 4 + content_length);
+        stream.erase(0, request.length());
+        scanned = 0;
 
-        std::string request(buffer);
-        std::string response_body;
-        std::string http_status = "200 OK";
-        bool keep_alive = true;
+        DbRequest req;
+        req.conn = conn;
+        req.body = request.substr(header_end + 4);
+        std::string headers = request.substr(0, header_end + 2);
+        req.keep_alive = headers.find("Connection: close") == std::string::npos;
 
-        if (request.find("Connection: close") != std::string::npos) 
+        size_t idPos = headers.find("X-Request-Id: ");
+        if (idPos != std::string::npos)
         {
-            keep_alive = false;
+            req.request_id = headers.substr(idPos + 14, headers.find("\r\n", idPos) - idPos - 14);
         }
-        
-        size_t start = request.find("GET /") + 5;
-        size_t end = request.find(" ", start);
 
+        req.is_post = headers.compare(0, 6, "POST /") == 0;
+        size_t start = req.is_post ? 6 : (headers.compare(0, 5, "GET /") == 0 ? 5 : std::string::npos);
+        size_t end = (start != std::string::npos) ? headers.find(" ", start) : std::string::npos;
         if (start == std::string::npos || end == std::string::npos)
         {
-            http_status = "400 Bad Request";
-            response_body = "Error: Malformed Request";
+            req.malformed = true;
         }
         else
         {
-            std::string pathAndQuery = request.substr(start, end - start);
+            std::string pathAndQuery = headers.substr(start, end - start);
             size_t queryPos = pathAndQuery.find("?");
-            std::string path = pathAndQuery.substr(0, queryPos);
-            std::string query = (queryPos != std::string::npos) ? pathAndQuery.substr(queryPos + 1) : "";
-
-            if (path == "db_set")
-                response_body = handle_db_set(query, http_status, conn);
-            else if (path == "db_get")
-                response_body = handle_db_get(query, http_status, conn);
-            else if (path == "db_delete")
-                response_body = handle_db_delete(query, http_status, conn);
-            else
+            req.path = pathAndQuery.substr(0, queryPos);
+            req.query = (queryPos != std::string::npos) ? pathAndQuery.substr(queryPos + 1) : "";
+        }
+
+        bool keep_alive = req.keep_alive;
+        if (req.request_id.empty() || !keep_alive)
+        {
+            req.answered = std::make_shared<std::promise<void>>();
+            std::future<void> answered = req.answered->get_future();
+            queue.push(std::move(req));
+            answered.wait();
+        }
+        else
+        {
+            queue.push(std::move(req));
+        }
+
+        if (!keep_alive) break;
+    }
+
+    remove_socket(conn->fd);
+    shutdown(conn->fd, SHUT_RD);
+    std::cout << "[INFO] Finished reading from Frontend connection." << std::endl;
+}
+
+std::string dispatch_binary(const DbRequest& req, std::string& http_status, PGconn* conn)
+{
+    switch (req.opcode())
+    {
+        case OP_GET:
+            return db_get(req.key(), http_status, conn);
+        case OP_SET:
+            return db_set(req.key(), req.value(), http_status, conn);
+        case OP_DELETE:
+            return db_delete(req.key(), http_status, conn);
+        case OP_PING:
+            return db_ping(http_status, conn);
+        case OP_MSET:
+        {
+            std::vector<std::pair<std::string_view, std::string_view>> pairs;
+            std::string_view rest = req.value();
+            while (rest.size() >= 8)
+            {
+                uint32_t key_len = get32(rest.data()), value_len = get32(rest.data() + 4);
+                if (rest.size() - 8 < (uint64_t)key_len + value_len) break;
+                pairs.emplace_back(rest.substr(8, key_len), rest.substr(8 + key_len, value_len));
+                rest.remove_prefix(8 + key_len + value_len);
+            }
+            if (!rest.empty())
             {
-                http_status = "404 Not Found";
-                response_body = "Internal API: /db_set, /db_get, /db_delete\n";
+                http_status = "400 Bad Request";
+                return "Error: malformed MSET pairs.";
             }
+            return db_mset(pairs, http_status, conn);
         }
+        case OP_KEYS:
+        {
+            long limit = req.value().size() >= 4 ? get32(req.value().data()) : MAX_KEYS_PAGE;
+            std::vector<std::string> keys;
+            std::string error = db_keys(req.flags() & BINARY_FLAG_AFTER, req.key(), limit, keys, http_status, conn);
+            if (!error.empty()) return error;
 
-        std::string http_response = "HTTP/1.1 " + http_status + "\r\n";
-        http_response += "Content-Type: text/plain\r\n";
-        http_response += "Content-Length: " + std::to_string(response_body.length()) + "\r\n";
-        http_response += (keep_alive) ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
-        http_response += "\r\n";
-        http_response += response_body;
+            std::string body;
+            for (const std::string& key : keys)
+            {
+                put32(body, key.size());
+                body += key;
+            }
+            return body;
+        }
+    }
 
-        send(new_socket, http_response.c_str(), http_response.length(), 0);
+    http_status = "400 Bad Request";
+    return "Error: unknown opcode.";
+}
 
-        if (!keep_alive) break;
+// Header and body go out in one sendmsg, so the body is never copied into a response buffer. MSG_NOSIGNAL
+// keeps a frontend that reset the connection from raising SIGPIPE.
+void send_binary_response(const DbRequest& req, const std::string& http_status, const std::string& response_body)
+{
+    uint16_t status = atoi(http_status.c_str());
+    char header[BINARY_HEADER_SIZE];
+    memcpy(header, req.frame.data(), 8);
+    header[2] = (char)status;
+    header[3] = (char)(status >> 8);
+    uint32_t lengths[2] = {0, (uint32_t)response_body.size()};
+    for (int i = 0; i < 2; i++)
+    {
+        for (int b = 0; b < 4; b++) header[8 + 4 * i + b] = (char)(lengths[i] >> (8 * b));
     }
 
-    close(new_socket);
-    std::cout << "[INFO] Worker finished with Frontend connection. Closing socket." << std::endl;
+    struct iovec iov[2] = {{header, BINARY_HEADER_SIZE}, {(void*)response_body.data(), response_body.size()}};
+    int iovcnt = 2, first = 0;
+
+    std::lock_guard<std::mutex> lock(req.conn->send_mutex);
+    while (!req.conn->dead && first < iovcnt)
+    {
+        struct msghdr msg = {};
+        msg.msg_iov = iov + first;
+        msg.msg_iovlen = iovcnt - first;
+        ssize_t n = sendmsg(req.conn->fd, &msg, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) 
+        {
+            req.conn->markDead();
+            break;
+        }
+        while (first < iovcnt && (size_t)n >= iov[first].iov_len)
+        {
+            n -= iov[first].iov_len;
+            first++;
+        }
+        if (first < iovcnt)
+        {
+            iov[first].iov_base = (char*)iov[first].iov_base + n;
+            iov[first].iov_len -= n;
+        }
+    }
 }
 
-int main()
+// Binary counterpart of handle_client. Frames may be far larger than one read and several may arrive in
+// one; a read that holds exactly one frame hands its buffer to the request without copying it.
+void handle_binary_client(std::shared_ptr<FrontendConnection> conn, ThreadSafeQueue<DbRequest>& queue)
 {
-    struct sigaction sa;
-    memset(&sa, 0, sizeof(sa));      
-    sa.sa_handler = signal_handler;  
-    if (sigaction(SIGINT, &sa, NULL) == -1) 
+    char buffer[BUFFER_SIZE];
+    std::string stream;
+
+    while (true)
     {
-        perror("sigaction failed");
-        return 1;
+        if (stream.length() >= BINARY_HEADER_SIZE)
+        {
+            uint64_t total = BINARY_HEADER_SIZE + (uint64_t)get32(&stream[8]) + get32(&stream[12]);
+            if ((unsigned char)stream[0] != BINARY_MAGIC || total > BINARY_MAX_FRAME)
+            {
+                std::cerr << "[ERROR] Malformed binary frame from Frontend. Closing connection." << std::endl;
+                break;
+            }
+            if (stream.length() >= total)
+            {
+                DbRequest req;
+                req.conn = conn;
+                req.binary = true;
+                if (stream.length() == total)
+                {
+                    req.frame = std::move(stream);
+                    stream = std::string();
+                }
+                else
+                {
+                    req.frame = stream.substr(0, total);
+                    stream.erase(0, total);
+                }
+                queue.push(std::move(req));
+                continue;
+            }
+            stream.reserve(total);
+        }
+
+        int bytes_read = read(conn->fd, buffer, BUFFER_SIZE);
+        if (bytes_read <= 0) break;
+        stream.append(buffer, bytes_read);
     }
-    
-    const std::string conninfo = "dbname=" + db_NAME + " user=dev password='123456' hostaddr=127.0.0.1 port=5432";
-    PGconn* main_conn = PQconnectdb(conninfo.c_str());
 
-    if(PQstatus(main_conn) != CONNECTION_OK)
+    remove_socket(conn->fd);
+    shutdown(conn->fd, SHUT_RD);
+    std::cout << "[INFO] Finished reading from Frontend connection." << std::endl;
+}
+
+// Each worker owns one DB connection and runs requests from any frontend connection.
+void worker_function(ThreadSafeQueue<DbRequest>& queue, PGconn* worker_conn)
+{
+    std::thread::id thread_id = std::this_thread::get_id();
+
+    DbRequest req;
+    while(queue.pop(req))
     {
-        std::cerr << "Connection to database failed: " << PQerrorMessage(main_conn) << std::endl;
-        PQfinish(main_conn);
-        return 1; 
+        std::string http_status = "200 OK";
+        if (req.binary)
+        {
+            send_binary_response(req, http_status, dispatch_binary(req, http_status, worker_conn));
+        }
+        else
+        {
+            send_response(req, http_status, dispatch(req, http_status, worker_conn));
+        }
+        if (req.answered) req.answered->set_value();
+        req = DbRequest();
     }
-    std::cout << "Successfully connected to PostgreSQL database." << std::endl;
-    create_Key_Value_Table(main_conn);
-    
-    //PQfinish(main_conn);
 
+    std::cout << "[INFO] Worker thread " << thread_id << " exiting." << std::endl;
+    PQfinish(worker_conn);
+}
 
+int open_listener(int port)
+{
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if(server_fd < 0) 
     { 
         perror("Socket creation failed"); 
-        return 1; 
+        return -1; 
     }
 
-
     int opt = 1;
     if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) 
     {
         perror("setsockopt failed");
         close(server_fd);
-        return 1;
+        return -1;
     }
 
     struct sockaddr_in server_address;
     server_address.sin_family = AF_INET;
     server_address.sin_addr.s_addr = INADDR_ANY;
-    server_address.sin_port = htons(BACKEND_PORT); 
+    server_address.sin_port = htons(port); 
 
     if (bind(server_fd, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) 
     {
         perror("Bind failed");
         close(server_fd);
-        return 1;
+        return -1;
     }
 
     if(listen(server_fd, 100) < 0) 
     {
         perror("Listen failed");
         close(server_fd);
+        return -1;
+    }
+    return server_fd;
+}
+
+int main(int argc, char* argv[])
+{
+    int num_threads = DEFAULT_NUM_THREADS;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc)
+        {
+            num_threads = std::max(1, std::stoi(argv[++i]));
+        }
+        else
+        {
+            std::cout << "Usage: ./backend [--threads <N>]" << std::endl;
+            return 1;
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));      
+    sa.sa_handler = signal_handler;  
+    if (sigaction(SIGINT, &sa, NULL) == -1) 
+    {
+        perror("sigaction failed");
         return 1;
     }
+    
+    PGconn* main_conn = PQconnectdb(db_CONNINFO.c_str());
+
+    if(PQstatus(main_conn) != CONNECTION_OK)
+    {
+        std::cerr << "Connection to database failed: " << PQerrorMessage(main_conn) << std::endl;
+        PQfinish(main_conn);
+        return 1; 
+    }
+    std::cout << "Successfully connected to PostgreSQL database." << std::endl;
+    create_Key_Value_Table(main_conn);
+    PQfinish(main_conn);
 
-    std::cout << "Key-Value BACKEND Server Listening for Frontend connections on port " << BACKEND_PORT << std::endl;
 
-    while(!g_shutdown_flag)
+    // Every worker's DB connection is opened up front, so a worker that cannot connect fails startup
+    // instead of leaving the pool short.
+    std::vector<PGconn*> worker_conns;
+    for(int i = 0; i < num_threads; i++)
+    {
+        PGconn* worker_conn = PQconnectdb(db_CONNINFO.c_str());
+        worker_conns.push_back(worker_conn);
+        if(PQstatus(worker_conn) != CONNECTION_OK)
+        {
+            std::cerr << "[FATAL] DB worker " << i << " failed to connect to DB: " << PQerrorMessage(worker_conn) << std::endl;
+            for(PGconn* conn : worker_conns) PQfinish(conn);
+            return 1;
+        }
+    }
+
+    int server_fd = open_listener(BACKEND_PORT);
+    int binary_fd = server_fd < 0 ? -1 : open_listener(BACKEND_BINARY_PORT);
+    if(binary_fd < 0)
     {
-        struct sockaddr_in client_address;
-        socklen_t client_addrlen = sizeof(client_address);
-        int new_socket = -1; 
+        if(server_fd >= 0) close(server_fd);
+        for(PGconn* conn : worker_conns) PQfinish(conn);
+        return 1;
+    }
+
+    std::cout << "Key-Value BACKEND Server Listening for Frontend connections on port " << BACKEND_PORT
+              << " (HTTP) and " << BACKEND_BINARY_PORT << " (binary)" << std::endl;
 
-        new_socket = accept(server_fd, (struct sockaddr *)&client_address, &client_addrlen);
+    ThreadSafeQueue<DbRequest> request_queue;
+    std::vector<std::thread> thread_pool;
 
-        if(new_socket < 0)
+    std::cout << "[INFO] Starting Thread Pool with " << num_threads << " DB workers." << std::endl;
+    for(int i = 0; i < num_threads; i++)
+    {
+        thread_pool.emplace_back(worker_function, std::ref(request_queue), worker_conns[i]);
+    }
+
+    struct pollfd listeners[2] = {{server_fd, POLLIN, 0}, {binary_fd, POLLIN, 0}};
+    while(!g_shutdown_flag)
+    {
+        if(poll(listeners, 2, -1) < 0)
         {
             if(g_shutdown_flag || errno == EINTR) {
                 std::cout << "[INFO] Accept Loop Interrupted." << std::endl;
                 break;
             }
-            perror("Connection Accept Failed");
+            perror("poll failed");
             continue;
         }
 
-        std::cout << "[INFO] Frontend connected. Processing Requests.." << std::endl;
-        handle_client(new_socket, main_conn);
+        for(const struct pollfd& listener : listeners)
+        {
+            if(!(listener.revents & POLLIN)) continue;
+
+            struct sockaddr_in client_address;
+            socklen_t client_addrlen = sizeof(client_address);
+            int new_socket = accept(listener.fd, (struct sockaddr *)&client_address, &client_addrlen);
+
+            if(new_socket < 0)
+            {
+                if(errno != EINTR) perror("Connection Accept Failed");
+                continue;
+            }
+
+            bool binary = listener.fd == binary_fd;
+            std::cout << "[INFO] Frontend connected" << (binary ? " (binary)" : "") << ". Processing Requests.." << std::endl;
+            // Responses to pipelined requests go out back to back; Nagle would hold each behind the previous one's ACK.
+            int one = 1;
+            setsockopt(new_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            add_socket(new_socket);
+            {
+                std::lock_guard<std::mutex> lock(g_active_socket_list_mutex);
+                g_active_readers++;
+            }
+            // The shared FrontendConnection outlives the reader for as long as its requests are pending.
+            std::thread([handler = binary ? handle_binary_client : handle_client,
+                         conn = std::make_shared<FrontendConnection>(new_socket), &request_queue]()
+            {
+                handler(conn, request_queue);
+                reader_exited();
+            }).detach();
+        }
     }
 
     std::cout << "\n[INFO] Server shutting down." << std::endl;
-    
+
+    // Frontend connections are persistent: unblock the readers still waiting on them, and let them queue
+    // what they already read before the workers are stopped.
+    {
+        std::unique_lock<std::mutex> lock(g_active_socket_list_mutex);
+        for(int sock : g_active_sockets) shutdown(sock, SHUT_RDWR);
+        g_readers_done.wait(lock, []() { return g_active_readers == 0; });
+    }
+    request_queue.stop();
+    for(std::thread& t : thread_pool)
+    {
+        t.join();
+    }
+    std::cout << "[INFO] All worker threads have exited." << std::endl;
+
     close(server_fd);
-    PQfinish(main_conn);
+    close(binary_fd);
 
     std::cout << "[INFO] Shutdown complete. " << std::endl;
     return 0;
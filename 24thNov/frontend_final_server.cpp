@@ -9,35 +9,126 @@
 #include <mutex>
 #include <csignal>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/utsname.h>
+#include <linux/io_uring.h>
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <queue>
+#include <deque>
 #include <condition_variable>
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <memory>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <new>
+#include <charconv>
+#include <climits>
+#include <cmath>
 
 #define FRONTEND_PORT 6969
 #define BACKEND_IP "127.0.0.1" 
 #define BACKEND_PORT 7000      
+#define BACKEND_BINARY_PORT 7001
 
 #define BUFFER_SIZE 10240
+#define MAX_REQUEST_SIZE (1024 * 1024)
+#define MAX_PIPELINED_RESPONSES 64
+#define REQUEST_ARENA_BYTES 16384
 
 const int NUM_THREADS = 8;
-#define N 100
+#define DEFAULT_CACHE_BYTES (64 * 1024 * 1024)
+#define DEFAULT_NUM_SHARDS 8
+// Upper bounds for command-line values.
+#define MAX_SHARDS 65536
+#define MAX_THREADS 1024
+#define TTL_REAPER_INTERVAL_MS 10
+#define DEFAULT_WRITEBACK_QUEUE 4096
+#define WRITEBACK_FLUSHERS 2
+#define WRITEBACK_RETRY_MS 100
+// A failed flush backs off exponentially up to this; a key is dropped after WRITEBACK_MAX_ATTEMPTS failed writes.
+#define WRITEBACK_RETRY_MAX_MS 5000
+#define WRITEBACK_MAX_ATTEMPTS 10
+#define WRITEBACK_BATCH 256
+// Raw key + value bytes per flush; even URL-encoded, a batch stays under the backend's 64 MiB request cap.
+#define WRITEBACK_BATCH_BYTES (16 * 1024 * 1024)
+#define WRITEBACK_LINGER_MS 2
+#define DEFAULT_NEGATIVE_ENTRIES 65536
+#define DEFAULT_NEGATIVE_TTL_MS 1000
+#define DEFAULT_PREPARED_RESPONSES 1024
+#define PREPARED_MAX_VALUE 4096
+#define DEFAULT_KEY_FILTER_BITS 10
+#define MAX_KEY_FILTER_BITS 64
+#define DEFAULT_KEY_FILTER_MIN_KEYS (1 << 20)
+#define KEY_FILTER_PAGE 10000
+#define KEY_FILTER_CHECK_MS 1000
+#define KEY_FILTER_MIN_REBUILD_DELETES 1024
+#define DEFAULT_BACKEND_CONNS 8
+#define DEFAULT_BACKEND_DEPTH 32
+#define BACKEND_HEALTH_INTERVAL_MS 1000
+#define DEFAULT_BACKEND_TIMEOUT_MS 5000
+#define BACKEND_ASYNC_TICK_MS 10
+#define URING_ENTRIES 1024
+#define URING_CQ_ENTRIES 16384
+#define URING_BUFFERS 4096
+#define URING_BUFFER_SIZE 1024
+#define URING_BUFFER_GROUP 1
+#define BINARY_MAGIC 0xB5
+#define BINARY_HEADER_SIZE 16
+#define BINARY_MAX_FRAME (64 * 1024 * 1024)
+#define BINARY_FLAG_AFTER 1
+
+#define CACHE_LINE_SIZE 64
+#define MAX_KEY_LENGTH 65535
 
 std::atomic<long> g_total_access(0);
 std::atomic<long> g_cache_hits(0);
+// Requests parsed off client connections, and the syscalls spent on those connections (accept, read,
+// send, epoll, io_uring_enter), whichever serving mode is running.
+std::atomic<long> g_client_requests(0);
+std::atomic<long> g_client_syscalls(0);
+// Bytes the frontend wrote itself to assemble responses (headers it rendered, bodies it copied or built),
+// as opposed to cached values sent from where they are stored.
+std::atomic<long> g_response_bytes_copied(0);
+std::atomic<long> g_zero_copy_responses(0);
+std::atomic<long> g_pin_saturated(0);
+std::atomic<long> g_prepared_sends(0);
 
-volatile sig_atomic_t g_shutdown_flag = 0;
-std::mutex g_store_mutex;
+#ifdef FRONTEND_ALLOC_COUNTING
+// Heap allocations made by the calling thread, counted by the operator new below for --bench-get-allocs.
+// Only built with -DFRONTEND_ALLOC_COUNTING, so the server itself keeps the standard allocator.
+// The replacements stay out of line, or GCC sees malloc paired with operator delete and warns.
+thread_local long t_heap_allocations = 0;
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    t_heap_allocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if(p == nullptr) throw std::bad_alloc();
+    return p;
+}
 
-int g_backend_sock = -1;
-std::mutex g_backend_mutex;
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+#endif
 
-int count_of_pairs = 0;
+volatile sig_atomic_t g_shutdown_flag = 0;
 
-std::vector<int> g_active_sockets;
+std::unordered_set<int> g_active_sockets;
 std::mutex g_active_socket_list_mutex;
 int g_server_fd = -1;
 
@@ -53,19 +144,16 @@ void heavy_computation()
 void add_socket(int sock)
 {
     std::lock_guard<std::mutex> lock(g_active_socket_list_mutex);
-    g_active_sockets.push_back(sock);
+    g_active_sockets.insert(sock);
 }
 
 void remove_socket(int sock)
 {
     std::lock_guard<std::mutex> lock(g_active_socket_list_mutex);
-    auto it = std::remove(g_active_sockets.begin(), g_active_sockets.end(), sock);
-
-    g_active_sockets.erase(it, g_active_sockets.end());
-    
+    g_active_sockets.erase(sock);
 }
 
-std::string urlEncode(const std::string& str)
+std::string urlEncode(std::string_view str)
 {
     std::string encoded;
     for(char c : str) 
@@ -83,9 +171,42 @@ std::string urlEncode(const std::string& str)
     return encoded;
 }
 
-std::string urlDecode(const std::string &str) 
+// Scratch memory for one request (decoded keys and parameters). Every worker thread has its own, and
+// answerRequests() resets it once the request is answered, so handling a request reuses the same block
+// instead of allocating. A request that outgrows the block spills into heap blocks freed at the reset.
+class RequestArena
+{
+    private:
+        char m_block[REQUEST_ARENA_BYTES];
+        size_t m_used = 0;
+        std::vector<std::unique_ptr<char[]>> m_spill;
+
+    public:
+        char* allocate(size_t n)
+        {
+            if(n <= sizeof(m_block) - m_used) 
+            {
+                char* p = m_block + m_used;
+                m_used += n;
+                return p;
+            }
+            m_spill.emplace_back(new char[n]);
+            return m_spill.back().get();
+        }
+
+        void reset()
+        {
+            m_used = 0;
+            m_spill.clear();
+        }
+};
+
+thread_local RequestArena t_request_arena;
+
+// Decodes into out, which must have room for str.size() bytes, and returns the decoded length.
+size_t urlDecodeTo(std::string_view str, char* out) 
 {
-    std::string decoded;
+    size_t len = 0;
     char hex[3] = {0};
     for(size_t i = 0; i < str.length(); i++) 
     {
@@ -95,21 +216,43 @@ std::string urlDecode(const std::string &str)
             {
                 hex[0] = str[i + 1];
                 hex[1] = str[i + 2];
-                decoded += static_cast<char>(strtol(hex, nullptr, 16));
+                out[len++] = static_cast<char>(strtol(hex, nullptr, 16));
                 i += 2;
             }
         } 
         else if(str[i] == '+') 
         {
-            decoded += ' ';
+            out[len++] = ' ';
         } else 
         {
-            decoded += str[i];
+            out[len++] = str[i];
         }
     }
+    return len;
+}
+
+std::string urlDecode(std::string_view str) 
+{
+    std::string decoded(str.size(), '\0');
+    decoded.resize(urlDecodeTo(str, &decoded[0]));
     return decoded;
 }
 
+// The decoded bytes live in the arena until its next reset.
+std::string_view urlDecode(std::string_view str, RequestArena& arena) 
+{
+    char* out = arena.allocate(str.size());
+    return std::string_view(out, urlDecodeTo(str, out));
+}
+
+size_t contentLength(const std::string& response, size_t header_end)
+{
+    // Only the headers are searched; the body may be large and hold anything.
+    size_t clPos = std::string_view(response).substr(0, header_end).find("Content-Length: ");
+    if(clPos == std::string_view::npos) return 0;
+    return strtoul(response.c_str() + clPos + 16, nullptr, 10);
+}
+
 std::string getResponseBody(const std::string& response) 
 {
     size_t body_start = response.find("\r\n\r\n");
@@ -120,15 +263,128 @@ std::string getResponseBody(const std::string& response)
     return "Error: Malformed Backend Response.";
 }
 
+// Writes the iovecs completely, resuming after partial writes; false once the connection fails.
+bool sendAll(int fd, struct iovec* iov, int iovcnt, std::atomic<long>* syscalls = nullptr)
+{
+    int first = 0;
+    while(first < iovcnt) 
+    {
+        struct msghdr msg = {};
+        msg.msg_iov = iov + first;
+        msg.msg_iovlen = std::min(iovcnt - first, IOV_MAX);
+        if(syscalls != nullptr) (*syscalls)++;
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        while(first < iovcnt && (size_t)n >= iov[first].iov_len) 
+        {
+            n -= iov[first].iov_len;
+            first++;
+        }
+        if(first < iovcnt) 
+        {
+            iov[first].iov_base = (char*)iov[first].iov_base + n;
+            iov[first].iov_len -= n;
+        }
+    }
+    return true;
+}
+
+// The 32-byte header and the first 32 bytes of key+value share the chunk's first cache line, so a hit on
+// a short entry (hash check, key compare, LRU relink, value copy) touches a single line.
 class Node 
 {
     public:
-        std::string key, value;
-        bool dirty = false;
-        Node* prev;
-        Node* next;
+        Node* prev = nullptr;
+        Node* next = nullptr;
+        uint64_t hash = 0;
+        uint32_t value_len = 0;
+        uint16_t key_len = 0;
+        uint8_t slab_class = 0;
+        std::atomic<uint8_t> flags{0};
+
+        static const uint8_t FLAG_DIRTY = 1;
+        static const uint8_t FLAG_REFERENCED = 2;
+        static const uint8_t POLICY_TAG_SHIFT = 2;
+        static const uint8_t POLICY_TAG_MASK = 0x0C;
+        static const uint8_t FLAG_EXPIRES = 0x10;
+        static const uint8_t PIN_ONE = 0x20;
+        static const uint8_t PIN_MASK = 0xE0;
+
+        static const size_t INLINE_BYTES;
+
+        bool isDirty() const { return flags.load(std::memory_order_relaxed) & FLAG_DIRTY; }
+
+        void setDirty(bool dirty)
+        {
+            if(dirty) flags.fetch_or(FLAG_DIRTY, std::memory_order_relaxed);
+            else flags.fetch_and(~FLAG_DIRTY, std::memory_order_relaxed);
+        }
+
+        // Only writes when the bit is clear, so repeated hits leave the cache line shared.
+        void markReferenced()
+        {
+            if(!(flags.load(std::memory_order_relaxed) & FLAG_REFERENCED)) 
+            {
+                flags.fetch_or(FLAG_REFERENCED, std::memory_order_relaxed);
+            }
+        }
+
+        bool clearReferenced()
+        {
+            return flags.fetch_and(~FLAG_REFERENCED, std::memory_order_relaxed) & FLAG_REFERENCED;
+        }
+
+        // Which list of the eviction policy the node is on (e.g. window/probation/protected).
+        uint8_t policyTag() const { return (flags.load(std::memory_order_relaxed) & POLICY_TAG_MASK) >> POLICY_TAG_SHIFT; }
+
+        void setPolicyTag(uint8_t tag)
+        {
+            uint8_t current = flags.load(std::memory_order_relaxed);
+            while(!flags.compare_exchange_weak(current, (current & ~POLICY_TAG_MASK) | ((tag << POLICY_TAG_SHIFT) & POLICY_TAG_MASK), std::memory_order_relaxed)) {}
+        }
+
+        bool hasExpiry() const { return flags.load(std::memory_order_relaxed) & FLAG_EXPIRES; }
+
+        // Keeps a retired node allocated while a response still points into it. The count lives in the top
+        // three bits of flags, so pin() fails once seven are held and the caller copies the value instead.
+        bool pin()
+        {
+            uint8_t current = flags.load(std::memory_order_relaxed);
+            do 
+            {
+                if((current & PIN_MASK) == PIN_MASK) return false;
+            } while(!flags.compare_exchange_weak(current, current + PIN_ONE, std::memory_order_relaxed));
+            return true;
+        }
 
-        Node(std::string k, std::string v) : key(k), value(v), dirty(false), prev(nullptr), next(nullptr) {}
+        void unpin() { flags.fetch_sub(PIN_ONE, std::memory_order_release); }
+
+        bool pinned() const { return flags.load(std::memory_order_acquire) & PIN_MASK; }
+
+        // Key bytes followed by value bytes live in the same slab chunk, directly after the header.
+        // Entries with a TTL keep their deadline in the 8 bytes just before the key.
+        char* data() { return reinterpret_cast<char*>(this + 1) + (hasExpiry() ? sizeof(uint64_t) : 0); }
+        const char* data() const { return reinterpret_cast<const char*>(this + 1) + (hasExpiry() ? sizeof(uint64_t) : 0); }
+
+        std::string_view key() const { return std::string_view(data(), key_len); }
+        std::string_view value() const { return std::string_view(data() + key_len, value_len); }
+
+        uint64_t expireAt() const
+        {
+            uint64_t deadline = 0;
+            if(hasExpiry()) memcpy(&deadline, reinterpret_cast<const char*>(this + 1), sizeof(deadline));
+            return deadline;
+        }
+
+        void setExpireAt(uint64_t deadline) { memcpy(reinterpret_cast<char*>(this + 1), &deadline, sizeof(deadline)); }
+
+        bool isExpired(uint64_t now_ms) const { return hasExpiry() && expireAt() <= now_ms; }
+
+        static size_t chunkSize(size_t key_len, size_t value_len, bool expires = false) 
+        { 
+            return sizeof(Node) + (expires ? sizeof(uint64_t) : 0) + key_len + value_len; 
+        }
 
         void moveToFront(Node* head) {
             if(head->next == this) return;
@@ -141,8 +397,188 @@ class Node
         }
 };
 
-Node* head = new Node("-1", "-1");
-Node* tail = new Node("-1", "-1");
+const size_t Node::INLINE_BYTES = CACHE_LINE_SIZE - sizeof(Node);
+static_assert(sizeof(Node) == 32, "Node header must leave half a cache line for inline key/value bytes");
+
+struct SlabClassStats
+{
+    size_t chunk_size = 0;
+    size_t pages = 0;
+    size_t total_chunks = 0;
+    size_t used_chunks = 0;
+    size_t requested_bytes = 0;
+};
+
+class SlabAllocator
+{
+    private:
+        static const size_t SLAB_PAGE_SIZE = 64 * 1024;
+        static const size_t MIN_CHUNK_SIZE = CACHE_LINE_SIZE;
+
+        struct FreeChunk 
+        { 
+            FreeChunk* next; 
+        };
+
+        struct SlabClass
+        {
+            SlabClassStats stats;
+            std::vector<char*> pages;
+            FreeChunk* free_list = nullptr;
+        };
+
+        std::vector<SlabClass> m_classes;
+        size_t m_large_items = 0;
+        size_t m_large_bytes = 0;
+
+        void addPage(SlabClass& sc)
+        {
+            char* page = static_cast<char*>(aligned_alloc(CACHE_LINE_SIZE, SLAB_PAGE_SIZE));
+            if(page == nullptr) throw std::bad_alloc();
+            sc.pages.push_back(page);
+            sc.stats.pages++;
+
+            size_t chunks = SLAB_PAGE_SIZE / sc.stats.chunk_size;
+            for(size_t i = chunks; i > 0; i--) 
+            {
+                FreeChunk* chunk = reinterpret_cast<FreeChunk*>(page + (i - 1) * sc.stats.chunk_size);
+                chunk->next = sc.free_list;
+                sc.free_list = chunk;
+            }
+            sc.stats.total_chunks += chunks;
+        }
+
+    public:
+        static const uint8_t LARGE_CLASS = 0xFF;
+
+        // Chunks are whole cache lines and pages are line-aligned, so every Node header starts a fresh line.
+        static size_t roundToCacheLine(size_t size)
+        {
+            return (size + CACHE_LINE_SIZE - 1) & ~static_cast<size_t>(CACHE_LINE_SIZE - 1);
+        }
+        static constexpr double GROWTH_FACTOR = 1.25;
+
+        SlabAllocator()
+        {
+            size_t size = MIN_CHUNK_SIZE;
+            while(size <= SLAB_PAGE_SIZE / 2) 
+            {
+                SlabClass sc;
+                sc.stats.chunk_size = size;
+                m_classes.push_back(sc);
+                size = roundToCacheLine(static_cast<size_t>(size * GROWTH_FACTOR));
+            }
+            SlabClass last;
+            last.stats.chunk_size = SLAB_PAGE_SIZE;
+            m_classes.push_back(last);
+        }
+
+        ~SlabAllocator()
+        {
+            for(SlabClass& sc : m_classes) 
+            {
+                for(char* page : sc.pages) free(page);
+            }
+        }
+
+        SlabAllocator(const SlabAllocator&) = delete;
+        SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+        uint8_t classFor(size_t size) const
+        {
+            for(size_t i = 0; i < m_classes.size(); i++) 
+            {
+                if(size <= m_classes[i].stats.chunk_size) return static_cast<uint8_t>(i);
+            }
+            return LARGE_CLASS;
+        }
+
+        size_t chunkCapacity(uint8_t cls) const
+        {
+            return cls == LARGE_CLASS ? 0 : m_classes[cls].stats.chunk_size;
+        }
+
+        // Bytes actually consumed by an item of this size, including the slack of its class.
+        size_t chunkBytes(size_t size) const
+        {
+            uint8_t cls = classFor(size);
+            return cls == LARGE_CLASS ? roundToCacheLine(size) : m_classes[cls].stats.chunk_size;
+        }
+
+        void* allocate(size_t size, uint8_t& cls)
+        {
+            cls = classFor(size);
+            if(cls == LARGE_CLASS) 
+            {
+                void* p = aligned_alloc(CACHE_LINE_SIZE, roundToCacheLine(size));
+                if(p == nullptr) throw std::bad_alloc();
+                m_large_items++;
+                m_large_bytes += size;
+                return p;
+            }
+
+            SlabClass& sc = m_classes[cls];
+            if(sc.free_list == nullptr) addPage(sc);
+
+            FreeChunk* chunk = sc.free_list;
+            sc.free_list = chunk->next;
+            sc.stats.used_chunks++;
+            sc.stats.requested_bytes += size;
+            return chunk;
+        }
+
+        // Freed chunks go to the head of their class free list, so the next insert of a similar size reuses the chunk that was just evicted.
+        void release(void* p, uint8_t cls, size_t size)
+        {
+            if(cls == LARGE_CLASS) 
+            {
+                m_large_items--;
+                m_large_bytes -= size;
+                free(p);
+                return;
+            }
+
+            SlabClass& sc = m_classes[cls];
+            FreeChunk* chunk = static_cast<FreeChunk*>(p);
+            chunk->next = sc.free_list;
+            sc.free_list = chunk;
+            sc.stats.used_chunks--;
+            sc.stats.requested_bytes -= size;
+        }
+
+        Node* allocNode(std::string_view key, std::string_view value, uint64_t expire_at = 0)
+        {
+            size_t size = Node::chunkSize(key.size(), value.size(), expire_at != 0);
+            uint8_t cls;
+            void* mem = allocate(size, cls);
+
+            Node* node = new (mem) Node();
+            node->slab_class = cls;
+            node->key_len = key.size();
+            node->value_len = value.size();
+            if(expire_at != 0) 
+            {
+                node->flags.fetch_or(Node::FLAG_EXPIRES, std::memory_order_relaxed);
+                node->setExpireAt(expire_at);
+            }
+            memcpy(node->data(), key.data(), key.size());
+            memcpy(node->data() + key.size(), value.data(), value.size());
+            return node;
+        }
+
+        void freeNode(Node* node)
+        {
+            size_t size = Node::chunkSize(node->key_len, node->value_len, node->hasExpiry());
+            uint8_t cls = node->slab_class;
+            node->~Node();
+            release(node, cls, size);
+        }
+
+        size_t numClasses() const { return m_classes.size(); }
+        const SlabClassStats& classStats(size_t i) const { return m_classes[i].stats; }
+        size_t largeItems() const { return m_large_items; }
+        size_t largeBytes() const { return m_large_bytes; }
+};
 
 void detachNode(Node *node) 
 {
@@ -150,7 +586,7 @@ void detachNode(Node *node)
     node->next->prev = node->prev;
 }
 
-void attachToFront(Node *node) 
+void attachToFront(Node *head, Node *node) 
 {
     node->next = head->next;
     node->prev = head;
@@ -158,472 +594,6219 @@ void attachToFront(Node *node)
     head->next = node;
 }
 
-using KeyValueStore = std::map<std::string, Node*>;
+class CachePolicy
+{
+    public:
+        virtual ~CachePolicy() {}
+        virtual const char* name() const = 0;
 
-class ThreadSafeQueue 
+        // Every lookup of a key, hit or miss, for policies that track frequency.
+        virtual void recordAccess(uint64_t hash) { (void)hash; }
+
+        virtual void onInsert(Node* node) = 0;
+        virtual void onHit(Node* node) = 0;
+        virtual void onRemove(Node* node) = 0;
+
+        // A hit served without the shard lock. Policies that can record it with atomics alone do so and
+        // return true; otherwise the shard replays it through onHit later, under the lock.
+        virtual bool onConcurrentHit(Node* node) { (void)node; return false; }
+
+        // Next entry to evict to make room for the key with incoming_hash.
+        virtual Node* victim(uint64_t incoming_hash) = 0;
+
+        // Removal of the node returned by victim(); policies with history override this.
+        virtual void onEvict(Node* node) { onRemove(node); }
+
+        // Entry count the shard settles at under its byte budget, refreshed on every eviction.
+        virtual void setCapacityHint(size_t entries) { (void)entries; }
+
+        // Called when a node is moved to a new chunk; the replacement takes over the old node's position.
+        virtual void onReplace(Node* old_node, Node* replacement)
+        {
+            replacement->setPolicyTag(old_node->policyTag());
+            replacement->prev = old_node->prev;
+            replacement->next = old_node->next;
+            old_node->prev->next = replacement;
+            old_node->next->prev = replacement;
+        }
+
+        virtual void forEach(const std::function<void(Node*)>& fn) = 0;
+
+        virtual std::string describe() const { return ""; }
+};
+
+// Strict LRU: every hit relinks the node at the head of the list.
+class LruPolicy : public CachePolicy
 {
     private:
-        std::queue<int> m_queue;
-        std::mutex m_mutex;
-        std::condition_variable m_cond;
-        bool m_stop = false;
+        Node m_head;
+        Node m_tail;
     public:
-        void push(int task) 
+        LruPolicy()
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_queue.push(task);
-            m_cond.notify_one();
+            m_head.next = &m_tail;
+            m_tail.prev = &m_head;
         }
-        int pop() 
+
+        const char* name() const override { return "lru"; }
+
+        void onInsert(Node* node) override { attachToFront(&m_head, node); }
+        void onHit(Node* node) override { node->moveToFront(&m_head); }
+        void onRemove(Node* node) override { detachNode(node); }
+        Node* victim(uint64_t) override { return m_tail.prev != &m_head ? m_tail.prev : nullptr; }
+
+        void forEach(const std::function<void(Node*)>& fn) override
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            while(m_stop == false && m_queue.empty()) 
+            for(Node* current = m_head.next; current != &m_tail; current = current->next) fn(current);
+        }
+};
+
+// CLOCK (second chance): a hit only sets the node's reference bit. The hand sweeps the ring on
+// insertion, clearing reference bits until it finds an unreferenced node to evict.
+class ClockPolicy : public CachePolicy
+{
+    private:
+        Node m_ring;
+        Node* m_hand;
+        size_t m_size = 0;
+
+        void advanceHand()
+        {
+            m_hand = m_hand->next;
+            if(m_hand == &m_ring) m_hand = m_ring.next;
+        }
+
+    public:
+        ClockPolicy() : m_hand(&m_ring)
+        {
+            m_ring.next = &m_ring;
+            m_ring.prev = &m_ring;
+        }
+
+        const char* name() const override { return "clock"; }
+
+        // New nodes go just behind the hand, so they are the last to be swept.
+        void onInsert(Node* node) override
+        {
+            Node* before = (m_hand == &m_ring) ? &m_ring : m_hand;
+            node->next = before;
+            node->prev = before->prev;
+            before->prev->next = node;
+            before->prev = node;
+            if(m_hand == &m_ring) m_hand = node;
+            m_size++;
+        }
+
+        void onHit(Node* node) override { node->markReferenced(); }
+        bool onConcurrentHit(Node* node) override { node->markReferenced(); return true; }
+
+        void onRemove(Node* node) override
+        {
+            if(m_hand == node) 
             {
-                m_cond.wait(lock);
+                advanceHand();
+                if(m_hand == node) m_hand = &m_ring;
             }
-            if(m_stop && m_queue.empty()) return -1;
-            int task = m_queue.front();
-            m_queue.pop();
-            return task;
+            detachNode(node);
+            m_size--;
         }
-        void stop() 
+
+        // Lock-free hits keep setting reference bits during the sweep, so it stops after two full
+        // revolutions and takes whatever is under the hand.
+        Node* victim(uint64_t) override
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_stop = true;
-            m_cond.notify_all();
+            if(m_hand == &m_ring) return nullptr;
+            for(size_t swept = 0; swept < 2 * m_size && m_hand->clearReferenced(); swept++) advanceHand();
+            return m_hand;
+        }
+
+        void onReplace(Node* old_node, Node* replacement) override
+        {
+            CachePolicy::onReplace(old_node, replacement);
+            if(m_hand == old_node) m_hand = replacement;
+        }
+
+        void forEach(const std::function<void(Node*)>& fn) override
+        {
+            for(Node* current = m_ring.next; current != &m_ring; current = current->next) fn(current);
         }
 };
 
-bool connectToBackend() 
+// Count-min sketch of 4-bit counters, 16 per word, 4 rows. Counters are halved every sample_size
+// increments so old popularity fades out.
+class FrequencySketch
 {
-    g_backend_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (g_backend_sock < 0) 
-    {
-        perror("ERROR: Failed to create socket for Backend connection.");
-        return false;
-    }
+    private:
+        std::vector<uint64_t> m_table;
+        size_t m_mask;
+        size_t m_sample_size;
+        size_t m_additions = 0;
 
-    struct sockaddr_in server_address;
-    server_address.sin_family = AF_INET;
-    server_address.sin_port = htons(BACKEND_PORT);
+        static const uint64_t SEEDS[4];
 
-    if (inet_pton(AF_INET, BACKEND_IP, &server_address.sin_addr) <= 0) 
-    {
-        perror("ERROR: Invalid Backend address.");
-        close(g_backend_sock);
-        g_backend_sock = -1;
-        return false;
-    }
+        size_t position(uint64_t hash, int row, int& nibble) const
+        {
+            uint64_t h = (hash + SEEDS[row]) * SEEDS[row];
+            h ^= h >> 32;
+            nibble = static_cast<int>((h >> 40) & 15) * 4;
+            return h & m_mask;
+        }
 
-    if (connect(g_backend_sock, (struct sockaddr*)&server_address, sizeof(server_address)) < 0) 
-    {
-        perror("ERROR: Failed to connect to Backend DB Server.");
-        close(g_backend_sock);
-        g_backend_sock = -1;
-        return false;
-    }
+        void halve()
+        {
+            for(uint64_t& word : m_table) word = (word >> 1) & 0x7777777777777777ULL;
+            m_additions /= 2;
+        }
 
-    std::cout << "[INFO] Successfully established persistent connection to Backend DB." << std::endl;
-    return true;
-}
+    public:
+        FrequencySketch(size_t capacity)
+        {
+            size_t width = 16;
+            while(width < capacity) width <<= 1;
+            m_table.assign(width, 0);
+            m_mask = width - 1;
+            m_sample_size = 10 * std::max<size_t>(capacity, 1);
+        }
+
+        int frequency(uint64_t hash) const
+        {
+            int freq = 15;
+            for(int row = 0; row < 4; row++) 
+            {
+                int nibble;
+                size_t idx = position(hash, row, nibble);
+                freq = std::min(freq, static_cast<int>((m_table[idx] >> nibble) & 15));
+            }
+            return freq;
+        }
+
+        void increment(uint64_t hash)
+        {
+            bool added = false;
+            for(int row = 0; row < 4; row++) 
+            {
+                int nibble;
+                size_t idx = position(hash, row, nibble);
+                if(((m_table[idx] >> nibble) & 15) < 15) 
+                {
+                    m_table[idx] += 1ULL << nibble;
+                    added = true;
+                }
+            }
+            if(added && ++m_additions >= m_sample_size) halve();
+        }
+};
+
+const uint64_t FrequencySketch::SEEDS[4] = {0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
 
-std::string sendToBackend(const std::string& path_and_query, std::string& http_status)
+// W-TinyLFU: new entries land in a small window LRU (1% of capacity). When the window overflows, its
+// oldest entry has to beat the main segmented LRU's victim on sketch frequency to get in, so a
+// one-hit wonder cannot push out a hot key. The loser of that duel is evicted first.
+class TinyLfuPolicy : public CachePolicy
 {
-    std::lock_guard<std::mutex> lock(g_backend_mutex);
+    private:
+        // REJECTED holds admission losers still cached until the shard next needs room.
+        enum Segment : uint8_t { WINDOW = 0, PROBATION = 1, PROTECTED = 2, REJECTED = 3 };
 
-    if (g_backend_sock == -1) 
-    {
-        http_status = "503 Service Unavailable";
-        return "ERROR: Backend connection is closed or failed to initialize.";
-    }
+        Node m_head[4];
+        Node m_tail[4];
+        size_t m_size[4] = {0, 0, 0, 0};
+        size_t m_capacity;
+        size_t m_window_cap;
+        size_t m_protected_cap;
+        FrequencySketch m_sketch;
 
-    std::string http_request = "GET " + path_and_query + " HTTP/1.1\r\nConnection: keep-alive\r\n\r\n";
-    
-    if (send(g_backend_sock, http_request.c_str(), http_request.length(), 0) < 0) 
-    {
-        perror("ERROR: Send to Backend failed");
-        http_status = "503 Service Unavailable";
-        return "ERROR: Failed to send data to Backend DB Server.";
-    }
+        void attach(Node* node, Segment seg)
+        {
+            attachToFront(&m_head[seg], node);
+            node->setPolicyTag(seg);
+            m_size[seg]++;
+        }
 
-    char buffer[BUFFER_SIZE] = {0};
-    std::string full_response;
-    int bytes_read = read(g_backend_sock, buffer, BUFFER_SIZE - 1);
-    
-    if (bytes_read <= 0) 
-    {
-        perror("ERROR: Read from Backend failed or connection closed");
-        http_status = "503 Service Unavailable";
-        return "ERROR: Failed to read response from Backend DB Server.";
-    }
+        void detach(Node* node)
+        {
+            detachNode(node);
+            m_size[node->policyTag()]--;
+        }
+
+        Node* last(Segment seg) { return m_tail[seg].prev != &m_head[seg] ? m_tail[seg].prev : nullptr; }
+
+    public:
+        TinyLfuPolicy(size_t capacity) : m_sketch(capacity)
+        {
+            for(int seg = 0; seg < 4; seg++) 
+            {
+                m_head[seg].next = &m_tail[seg];
+                m_tail[seg].prev = &m_head[seg];
+            }
+            setCapacityHint(capacity);
+        }
+
+        const char* name() const override { return "tinylfu"; }
+
+        void setCapacityHint(size_t entries) override
+        {
+            m_capacity = entries;
+            m_window_cap = std::max<size_t>(1, entries / 100);
+            m_protected_cap = (entries - std::min(entries, m_window_cap)) * 8 / 10;
+        }
+
+        void recordAccess(uint64_t hash) override { m_sketch.increment(hash); }
+
+        void onInsert(Node* node) override
+        {
+            attach(node, WINDOW);
+            if(m_size[WINDOW] <= m_window_cap) return;
+
+            Node* candidate = last(WINDOW);
+            Node* main_victim = last(PROBATION);
+            if(main_victim == nullptr) main_victim = last(PROTECTED);
+            // Until the shard is full there is room for both, and nothing needs to lose.
+            bool full = m_size[WINDOW] + m_size[PROBATION] + m_size[PROTECTED] + m_size[REJECTED] >= m_capacity;
+            detach(candidate);
+            if(!full || main_victim == nullptr || m_sketch.frequency(candidate->hash) > m_sketch.frequency(main_victim->hash)) 
+            {
+                attach(candidate, PROBATION);
+                if(full && main_victim != nullptr) 
+                {
+                    detach(main_victim);
+                    attach(main_victim, REJECTED);
+                }
+            }
+            else 
+            {
+                attach(candidate, REJECTED);
+            }
+        }
+
+        void onHit(Node* node) override
+        {
+            Segment seg = static_cast<Segment>(node->policyTag());
+            if(seg == REJECTED) 
+            {
+                // Hit again before it was evicted: back into the main segments on probation.
+                detach(node);
+                attach(node, PROBATION);
+                return;
+            }
+            if(seg != PROBATION) 
+            {
+                node->moveToFront(&m_head[seg]);
+                return;
+            }
+
+            detach(node);
+            attach(node, PROTECTED);
+            if(m_size[PROTECTED] > m_protected_cap) 
+            {
+                Node* demoted = last(PROTECTED);
+                detach(demoted);
+                attach(demoted, PROBATION);
+            }
+        }
+
+        void onRemove(Node* node) override { detach(node); }
+
+        Node* victim(uint64_t) override
+        {
+            if(m_size[REJECTED] > 0) return last(REJECTED);
+
+            Node* main_victim = last(PROBATION);
+            if(main_victim == nullptr) main_victim = last(PROTECTED);
+
+            Node* candidate = (m_size[WINDOW] >= m_window_cap) ? last(WINDOW) : nullptr;
+
+            if(candidate == nullptr) return main_victim != nullptr ? main_victim : last(WINDOW);
+            if(main_victim == nullptr) return candidate;
+
+            return m_sketch.frequency(candidate->hash) > m_sketch.frequency(main_victim->hash) ? main_victim : candidate;
+        }
+
+        std::string describe() const override
+        {
+            std::ostringstream out;
+            out << "window=" << m_size[WINDOW] << " probation=" << m_size[PROBATION] << " protected=" << m_size[PROTECTED] << " rejected=" << m_size[REJECTED];
+            return out.str();
+        }
+
+        void forEach(const std::function<void(Node*)>& fn) override
+        {
+            for(int seg = 0; seg < 4; seg++) 
+            {
+                for(Node* current = m_head[seg].next; current != &m_tail[seg]; current = current->next) fn(current);
+            }
+        }
+};
+
+// LRU list of evicted key hashes, used as ARC's B1/B2 ghost lists.
+class GhostList
+{
+    private:
+        std::list<uint64_t> m_order;
+        std::unordered_map<uint64_t, std::list<uint64_t>::iterator> m_index;
+    public:
+        size_t size() const { return m_order.size(); }
+        bool contains(uint64_t hash) const { return m_index.count(hash) > 0; }
+
+        void pushFront(uint64_t hash)
+        {
+            erase(hash);
+            m_order.push_front(hash);
+            m_index[hash] = m_order.begin();
+        }
+
+        void erase(uint64_t hash)
+        {
+            auto it = m_index.find(hash);
+            if(it == m_index.end()) return;
+            m_order.erase(it->second);
+            m_index.erase(it);
+        }
+
+        void popBack()
+        {
+            if(m_order.empty()) return;
+            m_index.erase(m_order.back());
+            m_order.pop_back();
+        }
+};
+
+// Adaptive Replacement Cache: T1 holds keys seen once recently, T2 keys seen at least twice. A key
+// inserted while on a ghost list moves the T1 target size p towards whichever list would have kept it.
+class ArcPolicy : public CachePolicy
+{
+    private:
+        enum ListId : uint8_t { T1 = 0, T2 = 1 };
+
+        Node m_head[2];
+        Node m_tail[2];
+        size_t m_size[2] = {0, 0};
+        GhostList m_b1;
+        GhostList m_b2;
+        size_t m_capacity;
+        double m_p = 0.0;
+
+        void attach(Node* node, ListId list)
+        {
+            attachToFront(&m_head[list], node);
+            node->setPolicyTag(list);
+            m_size[list]++;
+        }
+
+        void detach(Node* node)
+        {
+            detachNode(node);
+            m_size[node->policyTag()]--;
+        }
+
+        Node* last(ListId list) { return m_tail[list].prev != &m_head[list] ? m_tail[list].prev : nullptr; }
+
+        // The T1 target once the key with this hash is inserted; only ghost hits move it.
+        double targetFor(uint64_t hash) const
+        {
+            if(m_b1.contains(hash)) return std::min((double)m_capacity, m_p + std::max(1.0, (double)m_b2.size() / m_b1.size()));
+            if(m_b2.contains(hash)) return std::max(0.0, m_p - std::max(1.0, (double)m_b1.size() / m_b2.size()));
+            return m_p;
+        }
+
+        void trimGhosts()
+        {
+            while(m_b1.size() > 0 && m_size[T1] + m_b1.size() > m_capacity) m_b1.popBack();
+            while(m_b2.size() > 0 && m_size[T1] + m_size[T2] + m_b1.size() + m_b2.size() > 2 * m_capacity) m_b2.popBack();
+        }
+
+    public:
+        ArcPolicy(size_t capacity) : m_capacity(capacity)
+        {
+            for(int list = 0; list < 2; list++) 
+            {
+                m_head[list].next = &m_tail[list];
+                m_tail[list].prev = &m_head[list];
+            }
+        }
+
+        const char* name() const override { return "arc"; }
+
+        void setCapacityHint(size_t entries) override
+        {
+            m_capacity = std::max<size_t>(1, entries);
+            m_p = std::min(m_p, (double)m_capacity);
+        }
+
+        void onInsert(Node* node) override
+        {
+            if(m_b1.contains(node->hash) || m_b2.contains(node->hash)) 
+            {
+                m_p = targetFor(node->hash);
+                m_b1.erase(node->hash);
+                m_b2.erase(node->hash);
+                attach(node, T2);
+            }
+            else 
+            {
+                attach(node, T1);
+            }
+            trimGhosts();
+        }
+
+        void onHit(Node* node) override
+        {
+            if(node->policyTag() == T2) 
+            {
+                node->moveToFront(&m_head[T2]);
+                return;
+            }
+            detach(node);
+            attach(node, T2);
+        }
+
+        void onRemove(Node* node) override { detach(node); }
+
+        void onEvict(Node* node) override
+        {
+            if(node->policyTag() == T1) m_b1.pushFront(node->hash);
+            else m_b2.pushFront(node->hash);
+            detach(node);
+            trimGhosts();
+        }
+
+        // Evictions for a ghost hit already see the p its insert will set, as in ARC's REPLACE.
+        Node* victim(uint64_t incoming_hash) override
+        {
+            Node* t1_last = last(T1);
+            Node* t2_last = last(T2);
+            double p = targetFor(incoming_hash);
+            bool incoming_in_b2 = m_b2.contains(incoming_hash);
+            bool take_t1 = t1_last != nullptr && 
+                (m_size[T1] > p || (incoming_in_b2 && m_size[T1] == static_cast<size_t>(p)) || t2_last == nullptr);
+            return take_t1 ? t1_last : t2_last;
+        }
+
+        void forEach(const std::function<void(Node*)>& fn) override
+        {
+            for(int list = 0; list < 2; list++) 
+            {
+                for(Node* current = m_head[list].next; current != &m_tail[list]; current = current->next) fn(current);
+            }
+        }
+
+        std::string describe() const override
+        {
+            std::ostringstream out;
+            out << "p=" << m_p << " T1=" << m_size[T1] << " T2=" << m_size[T2] << " B1=" << m_b1.size() << " B2=" << m_b2.size();
+            return out.str();
+        }
+};
+
+std::unique_ptr<CachePolicy> makePolicy(const std::string& name, size_t capacity)
+{
+    if(name == "lru") return std::unique_ptr<CachePolicy>(new LruPolicy());
+    if(name == "clock") return std::unique_ptr<CachePolicy>(new ClockPolicy());
+    if(name == "tinylfu") return std::unique_ptr<CachePolicy>(new TinyLfuPolicy(capacity));
+    if(name == "arc") return std::unique_ptr<CachePolicy>(new ArcPolicy(capacity));
+    return nullptr;
+}
+
+// Epoch-based reclamation for the lock-free read path. A reader publishes the global epoch in its own
+// slot for as long as it holds pointers into the index; a writer tags whatever it unlinks with the
+// current epoch and frees it only once every reader still inside a critical section entered later.
+class EpochManager
+{
+    private:
+        static const size_t MAX_READERS = 256;
+
+        struct alignas(CACHE_LINE_SIZE) ReaderSlot 
+        { 
+            std::atomic<uint64_t> epoch{0}; 
+            std::atomic<bool> taken{false};
+        };
+
+        std::atomic<uint64_t> m_epoch{1};
+        // One past the highest slot ever taken; advance() scans no further.
+        std::atomic<size_t> m_used{0};
+        std::atomic<bool> m_warned{false};
+        ReaderSlot m_readers[MAX_READERS];
+
+    public:
+        static const size_t NO_SLOT = SIZE_MAX;
+
+        // Takes the lowest free slot. Slots come back with releaseReader() when their thread exits.
+        size_t registerReader()
+        {
+            for(size_t slot = 0; slot < MAX_READERS; slot++) 
+            {
+                bool expected = false;
+                if(m_readers[slot].taken.load(std::memory_order_relaxed) || !m_readers[slot].taken.compare_exchange_strong(expected, true)) continue;
+                size_t used = m_used.load();
+                while(used < slot + 1 && !m_used.compare_exchange_weak(used, slot + 1)) {}
+                return slot;
+            }
+            if(!m_warned.exchange(true)) 
+            {
+                std::cerr << "[WARN] More than " << MAX_READERS << " threads are reading the cache at once; the extra ones take the shard lock for every lookup." << std::endl;
+            }
+            return NO_SLOT;
+        }
+
+        void releaseReader(size_t slot)
+        {
+            if(slot == NO_SLOT) return;
+            m_readers[slot].epoch.store(0, std::memory_order_release);
+            m_readers[slot].taken.store(false, std::memory_order_release);
+        }
+
+        void enter(size_t slot)
+        {
+            m_readers[slot].epoch.store(m_epoch.load(), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        void exit(size_t slot) { m_readers[slot].epoch.store(0, std::memory_order_release); }
+
+        // Called after the object is unlinked, so no reader entering from now on can reach it.
+        uint64_t retireEpoch()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return m_epoch.load();
+        }
+
+        // Starts a new epoch and returns the oldest one still announced; objects retired before it are safe to free.
+        uint64_t advance()
+        {
+            uint64_t oldest = m_epoch.fetch_add(1) + 1;
+            size_t used = m_used.load();
+            for(size_t i = 0; i < used; i++) 
+            {
+                uint64_t e = m_readers[i].epoch.load(std::memory_order_acquire);
+                if(e != 0 && e < oldest) oldest = e;
+            }
+            return oldest;
+        }
+};
+
+EpochManager g_epochs;
+
+// A thread's reader slot, taken on its first lock-free lookup and given back when the thread exits.
+struct EpochReader
+{
+    size_t slot = g_epochs.registerReader();
+    ~EpochReader() { g_epochs.releaseReader(slot); }
+};
+
+// Keeps the calling thread inside an epoch critical section. Threads beyond MAX_READERS get an inactive
+// guard and must fall back to the locked path.
+class EpochGuard
+{
+    private:
+        size_t m_slot;
+    public:
+        EpochGuard()
+        {
+            static thread_local EpochReader t_reader;
+            m_slot = t_reader.slot;
+            if(m_slot != EpochManager::NO_SLOT) g_epochs.enter(m_slot);
+        }
+
+        ~EpochGuard()
+        {
+            if(m_slot != EpochManager::NO_SLOT) g_epochs.exit(m_slot);
+        }
+
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator=(const EpochGuard&) = delete;
+
+        bool active() const { return m_slot != EpochManager::NO_SLOT; }
+};
+
+struct IndexSlot
+{
+    uint64_t hash;
+    Node* node;
+};
+
+// Writers run under the shard mutex. Lock-free readers may probe concurrently: slots are published with
+// release stores, and tables dropped by a resize are retired through g_epochs rather than freed.
+class KeyValueStore
+{
+    private:
+        // Header and slots share one allocation, so a reader that loads the table pointer always sees
+        // the mask that belongs to it.
+        struct Table
+        {
+            size_t mask = 0;
+            size_t count = 0;
+            IndexSlot* slots = nullptr;
+        };
+
+        static const size_t MIN_SLOTS = 16;
+        static const size_t MIGRATE_BATCH = 32;
+
+        std::atomic<Table*> m_active;
+        std::atomic<Table*> m_old{nullptr};
+        size_t m_migrate_pos = 0;
+        size_t m_migrate_left = 0;
+        std::vector<std::pair<Table*, uint64_t>> m_retired;
+
+        static Table* allocTable(size_t num_slots)
+        {
+            void* mem = calloc(1, sizeof(Table) + num_slots * sizeof(IndexSlot));
+            if(mem == nullptr) throw std::bad_alloc();
+            Table* t = new (mem) Table();
+            t->slots = reinterpret_cast<IndexSlot*>(t + 1);
+            t->mask = num_slots - 1;
+            return t;
+        }
+
+        static void storeSlot(IndexSlot& s, IndexSlot entry)
+        {
+            __atomic_store_n(&s.hash, entry.hash, __ATOMIC_RELAXED);
+            __atomic_store_n(&s.node, entry.node, __ATOMIC_RELEASE);
+        }
+
+        static size_t probeDistance(const Table& t, uint64_t hash, size_t idx)
+        {
+            return (idx - (hash & t.mask)) & t.mask;
+        }
+
+        static void insertInto(Table& t, IndexSlot entry)
+        {
+            size_t idx = entry.hash & t.mask;
+            size_t dist = 0;
+            while(true) 
+            {
+                if(t.slots[idx].node == nullptr) 
+                {
+                    storeSlot(t.slots[idx], entry);
+                    t.count++;
+                    return;
+                }
+                size_t existing = probeDistance(t, t.slots[idx].hash, idx);
+                if(existing < dist) 
+                {
+                    IndexSlot displaced = t.slots[idx];
+                    storeSlot(t.slots[idx], entry);
+                    entry = displaced;
+                    dist = existing;
+                }
+                idx = (idx + 1) & t.mask;
+                dist++;
+            }
+        }
+
+        // Also used by lock-free readers, so every slot is read atomically and the probe is bounded even if
+        // a concurrent shift makes the cluster look inconsistent. A miss seen this way may be spurious.
+        static Node* findIn(const Table* t, std::string_view key, uint64_t hash)
+        {
+            if(t == nullptr) return nullptr;
+            size_t idx = hash & t->mask;
+            for(size_t dist = 0; dist <= t->mask; dist++) 
+            {
+                const IndexSlot& s = t->slots[idx];
+                Node* node = __atomic_load_n(&s.node, __ATOMIC_ACQUIRE);
+                uint64_t slot_hash = __atomic_load_n(&s.hash, __ATOMIC_RELAXED);
+                if(node == nullptr || probeDistance(*t, slot_hash, idx) < dist) return nullptr;
+                if(slot_hash == hash && node->hash == hash && node->key() == key) return node;
+                idx = (idx + 1) & t->mask;
+            }
+            return nullptr;
+        }
+
+        static IndexSlot* slotOf(Table* t, const Node* node, uint64_t hash)
+        {
+            if(t == nullptr) return nullptr;
+            size_t idx = hash & t->mask;
+            for(size_t dist = 0; ; dist++) 
+            {
+                IndexSlot& s = t->slots[idx];
+                if(s.node == nullptr || probeDistance(*t, s.hash, idx) < dist) return nullptr;
+                if(s.node == node) return &s;
+                idx = (idx + 1) & t->mask;
+            }
+        }
+
+        // Backward-shift deletion: pull the rest of the cluster one slot closer to home so no tombstone is left behind.
+        static void removeAt(Table& t, size_t idx)
+        {
+            size_t next = (idx + 1) & t.mask;
+            while(t.slots[next].node != nullptr && probeDistance(t, t.slots[next].hash, next) > 0) 
+            {
+                storeSlot(t.slots[idx], t.slots[next]);
+                idx = next;
+                next = (next + 1) & t.mask;
+            }
+            storeSlot(t.slots[idx], IndexSlot{0, nullptr});
+            t.count--;
+        }
+
+        static bool eraseFrom(Table* t, Node* node)
+        {
+            IndexSlot* s = slotOf(t, node, node->hash);
+            if(s == nullptr) return false;
+            removeAt(*t, s - t->slots);
+            return true;
+        }
+
+        // Moves whole clusters from the old table into the active one. A batch only stops on a cluster
+        // boundary so entries still left in the old table stay reachable by their probe sequence.
+        void migrateStep(size_t budget)
+        {
+            Table* old_table = m_old.load(std::memory_order_relaxed);
+            Table* active = m_active.load(std::memory_order_relaxed);
+            while(old_table != nullptr && m_migrate_left > 0) 
+            {
+                IndexSlot& s = old_table->slots[m_migrate_pos];
+                if(s.node != nullptr) 
+                {
+                    insertInto(*active, s);
+                    storeSlot(s, IndexSlot{0, nullptr});
+                    old_table->count--;
+                }
+                m_migrate_pos = (m_migrate_pos + 1) & old_table->mask;
+                m_migrate_left--;
+                if(budget > 0) budget--;
+
+                const IndexSlot& next = old_table->slots[m_migrate_pos];
+                bool mid_cluster = next.node != nullptr && probeDistance(*old_table, next.hash, m_migrate_pos) > 0;
+                if(budget == 0 && !mid_cluster) break;
+            }
+
+            if(old_table != nullptr && (m_migrate_left == 0 || old_table->count == 0)) 
+            {
+                m_old.store(nullptr, std::memory_order_release);
+                m_retired.emplace_back(old_table, g_epochs.retireEpoch());
+            }
+        }
+
+        void grow()
+        {
+            while(m_old.load(std::memory_order_relaxed) != nullptr) migrateStep(SIZE_MAX);
+
+            Table* old_table = m_active.load(std::memory_order_relaxed);
+            m_old.store(old_table, std::memory_order_release);
+            m_active.store(allocTable((old_table->mask + 1) * 2), std::memory_order_release);
+
+            m_migrate_pos = 0;
+            while(old_table->slots[m_migrate_pos].node != nullptr) m_migrate_pos++;
+            m_migrate_left = old_table->mask + 1;
+        }
+
+    public:
+        KeyValueStore() : m_active(allocTable(MIN_SLOTS)) {}
+
+        ~KeyValueStore()
+        {
+            free(m_active.load());
+            free(m_old.load());
+            for(auto& retired : m_retired) free(retired.first);
+        }
+
+        KeyValueStore(const KeyValueStore&) = delete;
+        KeyValueStore& operator=(const KeyValueStore&) = delete;
+
+        size_t size() const
+        {
+            const Table* old_table = m_old.load(std::memory_order_relaxed);
+            return m_active.load(std::memory_order_relaxed)->count + (old_table ? old_table->count : 0);
+        }
+
+        // Safe without the shard mutex inside an EpochGuard. A hit is always genuine; a miss may be a
+        // false negative while a writer is shifting entries, so readers confirm misses under the lock.
+        Node* find(std::string_view key, uint64_t hash) const
+        {
+            Node* node = findIn(m_active.load(std::memory_order_acquire), key, hash);
+            if(node == nullptr) node = findIn(m_old.load(std::memory_order_acquire), key, hash);
+            return node;
+        }
+
+        // Checks by pointer identity whether node is still indexed, without dereferencing it.
+        bool contains(const Node* node, uint64_t hash) const
+        {
+            return slotOf(m_active.load(std::memory_order_relaxed), node, hash) != nullptr
+                || slotOf(m_old.load(std::memory_order_relaxed), node, hash) != nullptr;
+        }
+
+        // The caller guarantees the key is not already present.
+        void insert(Node* node)
+        {
+            migrateStep(MIGRATE_BATCH);
+            Table* active = m_active.load(std::memory_order_relaxed);
+            if((active->count + 1) * 8 > (active->mask + 1) * 7) 
+            {
+                grow();
+                active = m_active.load(std::memory_order_relaxed);
+            }
+            insertInto(*active, IndexSlot{node->hash, node});
+        }
+
+        void erase(Node* node)
+        {
+            if(!eraseFrom(m_active.load(std::memory_order_relaxed), node)) eraseFrom(m_old.load(std::memory_order_relaxed), node);
+            migrateStep(MIGRATE_BATCH);
+        }
+
+        // Swaps in a node for the same key with a single store, so concurrent readers see either the old
+        // node or the replacement, never a gap.
+        void replace(Node* old_node, Node* replacement)
+        {
+            IndexSlot* s = slotOf(m_active.load(std::memory_order_relaxed), old_node, old_node->hash);
+            if(s == nullptr) s = slotOf(m_old.load(std::memory_order_relaxed), old_node, old_node->hash);
+            if(s != nullptr) __atomic_store_n(&s->node, replacement, __ATOMIC_RELEASE);
+        }
+
+        // Frees the tables retired before safe_epoch.
+        void reclaim(uint64_t safe_epoch)
+        {
+            size_t kept = 0;
+            for(auto& retired : m_retired) 
+            {
+                if(retired.second < safe_epoch) free(retired.first);
+                else m_retired[kept++] = retired;
+            }
+            m_retired.resize(kept);
+        }
+};
+
+uint64_t nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TimerRef
+{
+    Node* node;
+    uint64_t hash;
+    uint64_t expire_at;
+};
+
+// Hierarchical timing wheel with 1 ms ticks: 4 levels of 64 slots cover ~4.6 hours, later deadlines wait
+// in an overflow list. A timer at level L sits in slot (expire_at >> 6L) & 63 and is cascaded down
+// when the level below wraps around to it. Timers are never cancelled: when one fires, the caller
+// checks that the node is still cached and still due, so deletes and overwrites cost nothing here.
+class TimingWheel
+{
+    private:
+        static const int LEVELS = 4;
+        static const int SLOT_BITS = 6;
+        static const uint64_t SLOTS = 1 << SLOT_BITS;
+        static const uint64_t SLOT_MASK = SLOTS - 1;
+
+        std::vector<TimerRef> m_slots[LEVELS][SLOTS];
+        std::vector<TimerRef> m_overflow;
+        uint64_t m_now = 0;
+        size_t m_pending = 0;
+
+        void place(const TimerRef& ref)
+        {
+            uint64_t delta = ref.expire_at > m_now ? ref.expire_at - m_now : 0;
+            for(int level = 0; level < LEVELS; level++) 
+            {
+                if(delta < (1ULL << (SLOT_BITS * (level + 1)))) 
+                {
+                    uint64_t at = std::max(ref.expire_at, m_now + 1);
+                    m_slots[level][(at >> (SLOT_BITS * level)) & SLOT_MASK].push_back(ref);
+                    return;
+                }
+            }
+            m_overflow.push_back(ref);
+        }
+
+        void cascade(std::vector<TimerRef>& slot)
+        {
+            std::vector<TimerRef> refs;
+            refs.swap(slot);
+            for(const TimerRef& ref : refs) place(ref);
+        }
+
+    public:
+        size_t pending() const { return m_pending; }
+
+        void schedule(Node* node, uint64_t now_ms)
+        {
+            if(m_now == 0) m_now = now_ms;
+            place(TimerRef{node, node->hash, node->expireAt()});
+            m_pending++;
+        }
+
+        // Advances the wheel to now_ms and appends every timer that came due to `due`.
+        void advance(uint64_t now_ms, std::vector<TimerRef>& due)
+        {
+            if(m_pending == 0 || m_now == 0) 
+            {
+                m_now = now_ms;
+                return;
+            }
+
+            while(m_now < now_ms) 
+            {
+                m_now++;
+                for(int level = LEVELS - 1; level > 0; level--) 
+                {
+                    if((m_now & ((1ULL << (SLOT_BITS * level)) - 1)) == 0) 
+                    {
+                        cascade(m_slots[level][(m_now >> (SLOT_BITS * level)) & SLOT_MASK]);
+                    }
+                }
+                if((m_now & ((1ULL << (SLOT_BITS * LEVELS)) - 1)) == 0) cascade(m_overflow);
+
+                std::vector<TimerRef>& slot = m_slots[0][m_now & SLOT_MASK];
+                for(const TimerRef& ref : slot) due.push_back(ref);
+                m_pending -= slot.size();
+                slot.clear();
+            }
+        }
+};
+
+// Hashes of keys the backend recently answered 404 for, so repeated gets of missing keys skip the round
+// trip until the entry expires. 4-way set associative with a fixed number of slots: a full set drops
+// the entry closest to expiry. Only the 64-bit hash is kept, so two keys colliding on it share an entry.
+class NegativeCache
+{
+    private:
+        static const size_t WAYS = 4;
+
+        struct Slot
+        {
+            uint64_t hash;
+            uint64_t expire_at; // 0 = empty
+        };
+
+        std::vector<Slot> m_slots;
+        size_t m_set_mask = 0;
+        size_t m_used = 0;
+
+        Slot* setFor(uint64_t hash) { return &m_slots[(hash & m_set_mask) * WAYS]; }
+
+    public:
+        explicit NegativeCache(size_t max_entries)
+        {
+            if(max_entries == 0) return;
+            size_t sets = 1;
+            while(sets * WAYS < max_entries) sets <<= 1;
+            m_slots.assign(sets * WAYS, Slot{0, 0});
+            m_set_mask = sets - 1;
+        }
+
+        bool enabled() const { return !m_slots.empty(); }
+        size_t capacity() const { return m_slots.size(); }
+        size_t size() const { return m_used; }
+        size_t memoryBytes() const { return m_slots.size() * sizeof(Slot); }
+
+        bool contains(uint64_t hash, uint64_t now_ms)
+        {
+            if(!enabled()) return false;
+            Slot* set = setFor(hash);
+            for(size_t w = 0; w < WAYS; w++) 
+            {
+                if(set[w].expire_at == 0 || set[w].hash != hash) continue;
+                if(set[w].expire_at > now_ms) return true;
+                set[w].expire_at = 0;
+                m_used--;
+                return false;
+            }
+            return false;
+        }
+
+        void insert(uint64_t hash, uint64_t expire_at)
+        {
+            if(!enabled()) return;
+            Slot* set = setFor(hash);
+            Slot* victim = &set[0];
+            for(size_t w = 0; w < WAYS; w++) 
+            {
+                if(set[w].expire_at != 0 && set[w].hash == hash) 
+                {
+                    set[w].expire_at = expire_at;
+                    return;
+                }
+                // Empty and expired slots have the smallest expire_at, so they are taken first.
+                if(set[w].expire_at < victim->expire_at) victim = &set[w];
+            }
+            if(victim->expire_at == 0) m_used++;
+            victim->hash = hash;
+            victim->expire_at = expire_at;
+        }
+
+        bool erase(uint64_t hash)
+        {
+            if(!enabled()) return false;
+            Slot* set = setFor(hash);
+            for(size_t w = 0; w < WAYS; w++) 
+            {
+                if(set[w].expire_at != 0 && set[w].hash == hash) 
+                {
+                    set[w].expire_at = 0;
+                    m_used--;
+                    return true;
+                }
+            }
+            return false;
+        }
+};
+
+// Split-block Bloom filter of every key the backend holds, so gets of keys that were never stored are
+// answered without a round trip. A key sets one bit in each of the 8 words of a single 32-byte block,
+// so a probe touches one cache line and tests 8 independent words (one 256-bit AND with SIMD). Bits are
+// only ever set, with atomic ORs, so a delete cannot take its key out. Deletes go into a small side
+// filter instead, which tells a deleted key's 404 apart from a real false positive. Once deletes pile up,
+// or new keys fill the blocks past their design point, key_filter_function rebuilds the whole filter in
+// the background (buildKeyFilter). Until the first build is in place, every key may be present.
+//
+// A build is published before it collects any keys, and every insert goes to it as well as to the live
+// table, so a set racing a build (the startup load included) is never lost. Tables are swapped and freed
+// under the reader epochs; a thread without an epoch slot inserts under m_fallback_mutex and probes nothing.
+class BlockedBloomFilter
+{
+    private:
+        static const size_t WORDS = 8;
+
+        struct alignas(32) Block
+        {
+            uint32_t words[WORDS];
+        };
+
+        struct Table
+        {
+            std::vector<Block> blocks;
+            // Keys deleted since the table was built; only used to classify 404s.
+            std::vector<Block> deleted;
+            // Probe FPR once the table holds the keys it was sized for.
+            double design_fpr = 0.0;
+            long built_keys = 0;
+            std::atomic<long> keys{0};
+            std::atomic<long> deletes{0};
+        };
+
+        std::atomic<Table*> m_active{nullptr};
+        std::atomic<Table*> m_building{nullptr};
+        std::mutex m_fallback_mutex;
+        size_t m_bits_per_key = 0;
+        std::atomic<long> m_builds{0};
+
+        static void masks(uint64_t hash, uint32_t out[WORDS])
+        {
+            static const uint32_t SALT[WORDS] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                                 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+            uint32_t low = static_cast<uint32_t>(hash);
+            for(size_t i = 0; i < WORDS; i++) out[i] = 1U << ((low * SALT[i]) >> 27);
+        }
+
+        static Block& blockFor(std::vector<Block>& blocks, uint64_t hash) { return blocks[((hash >> 32) * blocks.size()) >> 32]; }
+
+        static void add(std::vector<Block>& blocks, uint64_t hash)
+        {
+            uint32_t mask[WORDS];
+            masks(hash, mask);
+            Block& block = blockFor(blocks, hash);
+            for(size_t i = 0; i < WORDS; i++) __atomic_fetch_or(&block.words[i], mask[i], __ATOMIC_RELAXED);
+        }
+
+        static bool test(std::vector<Block>& blocks, uint64_t hash)
+        {
+            uint32_t mask[WORDS];
+            masks(hash, mask);
+            Block& block = blockFor(blocks, hash);
+            uint32_t missing = 0;
+            for(size_t i = 0; i < WORDS; i++) missing |= mask[i] & ~__atomic_load_n(&block.words[i], __ATOMIC_RELAXED);
+            return missing == 0;
+        }
+
+        // Mean fraction of bits set per word, from up to 4096 evenly spaced blocks.
+        static double fill(const Table& table)
+        {
+            size_t step = std::max<size_t>(1, table.blocks.size() / 4096);
+            size_t bits = 0, words = 0;
+            for(size_t b = 0; b < table.blocks.size(); b += step) 
+            {
+                for(size_t i = 0; i < WORDS; i++) bits += __builtin_popcount(__atomic_load_n(&table.blocks[b].words[i], __ATOMIC_RELAXED));
+                words += WORDS;
+            }
+            return words > 0 ? (double)bits / (words * 32) : 0.0;
+        }
+
+        // Returns once no thread can still hold a table unpublished before the call.
+        static void waitForReaders()
+        {
+            uint64_t retired = g_epochs.retireEpoch();
+            while(g_epochs.advance() <= retired) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // Runs fn on the live and the building table, inside an epoch or, without a slot, under the fallback mutex.
+        template <typename Fn>
+        void forEachTable(Fn fn)
+        {
+            EpochGuard guard;
+            std::unique_lock<std::mutex> lock(m_fallback_mutex, std::defer_lock);
+            if(!guard.active()) lock.lock();
+            Table* active = m_active.load(std::memory_order_acquire);
+            Table* building = m_building.load(std::memory_order_acquire);
+            if(active != nullptr) fn(*active);
+            if(building != nullptr) fn(*building);
+        }
+
+    public:
+        std::atomic<long> rejected{0};
+        std::atomic<long> false_positives{0};
+        std::atomic<long> deleted_hits{0};
+
+        ~BlockedBloomFilter()
+        {
+            delete m_active.load();
+            delete m_building.load();
+        }
+
+        // Before the first build.
+        void setBitsPerKey(size_t bits_per_key) { m_bits_per_key = bits_per_key; }
+
+        bool ready() const { return m_active.load(std::memory_order_acquire) != nullptr; }
+
+        void insert(uint64_t hash)
+        {
+            forEachTable([&](Table& table) { add(table.blocks, hash); table.keys++; });
+        }
+
+        // A key the backend no longer holds. It still passes the filter until the next rebuild.
+        void recordDelete(uint64_t hash)
+        {
+            forEachTable([&](Table& table) { add(table.deleted, hash); table.deletes++; });
+        }
+
+        bool mayContain(uint64_t hash)
+        {
+            EpochGuard guard;
+            if(!guard.active()) return true;
+            Table* active = m_active.load(std::memory_order_acquire);
+            return active == nullptr || test(active->blocks, hash);
+        }
+
+        // Whether a key that passed but was not found had been deleted since the last build.
+        bool wasDeleted(uint64_t hash)
+        {
+            EpochGuard guard;
+            if(!guard.active()) return false;
+            Table* active = m_active.load(std::memory_order_acquire);
+            return active != nullptr && test(active->deleted, hash);
+        }
+
+        // Publishes an empty table sized for expected_keys; inserts reach it from here on. Only one build at a time.
+        void beginBuild(size_t expected_keys)
+        {
+            Table* table = new Table();
+            size_t blocks = std::max<size_t>(1, (expected_keys * m_bits_per_key + 255) / 256);
+            table->blocks.assign(blocks, Block{});
+            table->deleted.assign(std::max<size_t>(1, blocks / 4), Block{});
+            double word_fill = 1.0 - std::pow(31.0 / 32.0, (double)expected_keys / blocks);
+            table->design_fpr = std::pow(word_fill, (double)WORDS);
+            {
+                std::lock_guard<std::mutex> lock(m_fallback_mutex);
+                m_building.store(table, std::memory_order_release);
+            }
+            // An insert that missed the new table has finished, so its key is visible to the build's scan.
+            waitForReaders();
+        }
+
+        // The builder's own inserts; only it touches the table's bits this way besides concurrent inserts.
+        void addToBuild(uint64_t hash)
+        {
+            Table* building = m_building.load(std::memory_order_acquire);
+            add(building->blocks, hash);
+            building->keys++;
+        }
+
+        void finishBuild()
+        {
+            Table* old;
+            {
+                std::lock_guard<std::mutex> lock(m_fallback_mutex);
+                Table* built = m_building.load(std::memory_order_relaxed);
+                built->built_keys = built->keys;
+                old = m_active.exchange(built, std::memory_order_acq_rel);
+                m_building.store(nullptr, std::memory_order_release);
+                m_builds++;
+            }
+            waitForReaders();
+            delete old;
+        }
+
+        void abortBuild()
+        {
+            Table* building;
+            {
+                std::lock_guard<std::mutex> lock(m_fallback_mutex);
+                building = m_building.exchange(nullptr, std::memory_order_acq_rel);
+            }
+            waitForReaders();
+            delete building;
+        }
+
+        // Keys the live table holds, estimated from how full its words are; deleted keys still count.
+        size_t estimatedKeys()
+        {
+            EpochGuard guard;
+            std::unique_lock<std::mutex> lock(m_fallback_mutex, std::defer_lock);
+            if(!guard.active()) lock.lock();
+            Table* active = m_active.load(std::memory_order_acquire);
+            if(active == nullptr) return 0;
+            double f = std::min(fill(*active), 0.999);
+            size_t estimate = active->blocks.size() * std::log(1.0 - f) / std::log(31.0 / 32.0);
+            return std::max<size_t>(estimate, active->built_keys);
+        }
+
+        // Deletes reached a quarter of the keys the table was built with, or new keys pushed its FPR past the design point.
+        bool needsRebuild(size_t min_deletes)
+        {
+            EpochGuard guard;
+            std::unique_lock<std::mutex> lock(m_fallback_mutex, std::defer_lock);
+            if(!guard.active()) lock.lock();
+            Table* active = m_active.load(std::memory_order_acquire);
+            if(active == nullptr) return false;
+            long deletes = active->deletes;
+            if(deletes >= (long)min_deletes && deletes * 4 >= active->built_keys) return true;
+            return std::pow(fill(*active), (double)WORDS) > active->design_fpr;
+        }
+
+        std::string describe()
+        {
+            EpochGuard guard;
+            std::unique_lock<std::mutex> lock(m_fallback_mutex, std::defer_lock);
+            if(!guard.active()) lock.lock();
+            Table* active = m_active.load(std::memory_order_acquire);
+            if(active == nullptr) return "Key filter: not loaded, every miss goes to the backend\n";
+            std::ostringstream out;
+            out << "Key filter: " << active->keys << " keys inserted (" << active->built_keys << " when built, " << m_builds << " builds so far), " 
+                << active->blocks.size() * sizeof(Block) << " bytes (" << m_bits_per_key << " bits/key), estimated FPR " 
+                << std::pow(fill(*active), (double)WORDS) * 100.0 << "%, " << active->deletes << " deletes since build, " 
+                << rejected << " gets answered without the backend, " << false_positives << " false positives and " 
+                << deleted_hits << " deleted keys (backend 404 after passing)\n";
+            return out.str();
+        }
+};
+
+BlockedBloomFilter g_key_filter;
+
+struct InFlightFetch;
+
+// A request parked on another request's fetch by an event loop, which cannot block until it is done.
+class FetchWaiter
+{
+    public:
+        virtual ~FetchWaiter() {}
+        // Called under the shard mutex once the fetch is done, with ownership of the waiter; it should only
+        // pass itself on to its loop.
+        virtual void fetched(const InFlightFetch& fetch) = 0;
+};
+
+// A backend fetch in progress for one key. Requests that miss on the same key wait for it instead of
+// sending their own /db_get: threads on the shard's fetch_cond, event loops as waiters. A set or delete of
+// the key marks it invalidated: its result is then neither cached nor handed to the waiters, who look the
+// key up again.
+struct InFlightFetch
+{
+    bool done = false;
+    bool invalidated = false;
+    std::string status;
+    std::string value;
+    std::vector<std::unique_ptr<FetchWaiter>> waiters;
+};
+
+// A complete keep-alive 200 response for one cached node (status line, headers and value), sent as a
+// single buffer. Like a node it is freed only once its retire epoch is safe and no response refers to it.
+struct PreparedResponse
+{
+    const Node* node;
+    size_t header_bytes;
+    std::string bytes;
+    std::atomic<uint32_t> refs{0};
+    std::atomic<bool> referenced{false};
+
+    std::string_view body() const { return std::string_view(bytes).substr(header_bytes); }
+};
+
+// Ready-to-send responses for hot entries, one direct-mapped slot per node hash. Readers look a node up
+// without the shard lock; building, replacing and invalidating run under it. A node that loses its slot
+// is only displaced once the occupant has gone unreferenced since the last attempt (second chance).
+class PreparedResponses
+{
+    private:
+        std::unique_ptr<std::atomic<PreparedResponse*>[]> m_slots;
+        size_t m_size = 0;
+        std::vector<std::pair<PreparedResponse*, uint64_t>> m_retired;
+        size_t m_held = 0;
+        size_t m_held_bytes = 0;
+
+        std::atomic<PreparedResponse*>& slotFor(uint64_t hash) { return m_slots[hash & (m_size - 1)]; }
+
+        static size_t footprint(const PreparedResponse* prepared) { return sizeof(PreparedResponse) + prepared->bytes.capacity(); }
+
+        void retire(std::atomic<PreparedResponse*>& slot)
+        {
+            PreparedResponse* prepared = slot.exchange(nullptr, std::memory_order_relaxed);
+            m_held--;
+            m_held_bytes -= footprint(prepared);
+            m_retired.emplace_back(prepared, g_epochs.retireEpoch());
+        }
+
+    public:
+        long builds = 0;
+        long displaced = 0;
+        long invalidated = 0;
+
+        explicit PreparedResponses(size_t max_entries)
+        {
+            if(max_entries == 0) return;
+            m_size = 1;
+            while(m_size < max_entries) m_size <<= 1;
+            m_slots.reset(new std::atomic<PreparedResponse*>[m_size]());
+        }
+
+        ~PreparedResponses()
+        {
+            for(size_t i = 0; i < m_size; i++) delete m_slots[i].load(std::memory_order_relaxed);
+            for(auto& r : m_retired) delete r.first;
+        }
+
+        bool enabled() const { return m_size > 0; }
+        size_t capacity() const { return m_size; }
+        size_t size() const { return m_held; }
+        size_t retiredCount() const { return m_retired.size(); }
+        size_t memoryBytes() const { return m_size * sizeof(std::atomic<PreparedResponse*>) + m_held_bytes; }
+
+        // Without the lock, inside an EpochGuard that also covers the node.
+        PreparedResponse* find(const Node* node)
+        {
+            if(!enabled()) return nullptr;
+            PreparedResponse* prepared = slotFor(node->hash).load(std::memory_order_acquire);
+            if(prepared == nullptr || prepared->node != node) return nullptr;
+            if(!prepared->referenced.load(std::memory_order_relaxed)) prepared->referenced.store(true, std::memory_order_relaxed);
+            return prepared;
+        }
+
+        // Without the lock: whether build() could give the node a slot right now, so a reader only takes the
+        // lock when it would get something for it.
+        bool wants(const Node* node)
+        {
+            if(!enabled() || node->value_len > PREPARED_MAX_VALUE) return false;
+            PreparedResponse* occupant = slotFor(node->hash).load(std::memory_order_acquire);
+            return occupant == nullptr || (occupant->node != node && !occupant->referenced.load(std::memory_order_relaxed));
+        }
+
+        // Everything below runs under the shard mutex, with the node still indexed.
+        PreparedResponse* build(const Node* node)
+        {
+            if(!enabled() || node->value_len > PREPARED_MAX_VALUE) return nullptr;
+            std::atomic<PreparedResponse*>& slot = slotFor(node->hash);
+            PreparedResponse* occupant = slot.load(std::memory_order_relaxed);
+            if(occupant != nullptr) 
+            {
+                if(occupant->node == node) return occupant;
+                if(occupant->referenced.exchange(false, std::memory_order_relaxed)) return nullptr;
+                retire(slot);
+                displaced++;
+            }
+
+            char length[24];
+            size_t length_size = std::to_chars(length, length + sizeof(length), node->value_len).ptr - length;
+
+            PreparedResponse* prepared = new PreparedResponse;
+            prepared->node = node;
+            prepared->bytes.reserve(96 + node->value_len);
+            prepared->bytes += "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: ";
+            prepared->bytes.append(length, length_size);
+            prepared->bytes += "\r\nConnection: keep-alive\r\n\r\n";
+            prepared->header_bytes = prepared->bytes.size();
+            prepared->bytes += node->value();
+
+            slot.store(prepared, std::memory_order_release);
+            m_held++;
+            m_held_bytes += footprint(prepared);
+            builds++;
+            return prepared;
+        }
+
+        void invalidate(const Node* node)
+        {
+            if(!enabled()) return;
+            std::atomic<PreparedResponse*>& slot = slotFor(node->hash);
+            PreparedResponse* occupant = slot.load(std::memory_order_relaxed);
+            if(occupant == nullptr || occupant->node != node) return;
+            retire(slot);
+            invalidated++;
+        }
+
+        void reclaim(uint64_t safe_epoch)
+        {
+            size_t kept = 0;
+            for(auto& r : m_retired) 
+            {
+                if(r.second < safe_epoch && r.first->refs.load(std::memory_order_acquire) == 0) delete r.first;
+                else m_retired[kept++] = r;
+            }
+            m_retired.resize(kept);
+        }
+};
+
+struct CacheShard
+{
+    static const size_t READ_BUFFER_SIZE = 64;
+    static const size_t RECLAIM_BATCH = 64;
+
+    std::mutex mutex;
+    std::unique_ptr<CachePolicy> policy;
+    KeyValueStore store;
+    SlabAllocator slab;
+    TimingWheel wheel;
+    NegativeCache negative;
+    uint64_t negative_ttl_ms;
+    PreparedResponses prepared;
+    int count_of_pairs = 0;
+    size_t bytes_used = 0;
+    size_t capacity_bytes;
+
+    std::atomic<long> total_access{0};
+    std::atomic<long> cache_hits{0};
+    std::atomic<long> expired_on_lookup{0};
+    std::atomic<long> expired_by_wheel{0};
+    std::atomic<long> lock_free_hits{0};
+    std::atomic<long> coalesced_misses{0};
+    std::atomic<long> negative_hits{0};
+    std::atomic<long> negative_invalidations{0};
+
+    // Keyed by the keys currently being fetched from the backend; fetch_cond is signalled when one completes.
+    std::unordered_map<std::string, std::shared_ptr<InFlightFetch>> inflight;
+    std::condition_variable fetch_cond;
+
+    // Nodes unlinked from the index but possibly still read by lock-free readers, with their retire epoch.
+    std::vector<std::pair<Node*, uint64_t>> retired;
+
+    // Lossy ring of nodes hit without the lock, replayed into the policy by drainReadBuffer().
+    std::atomic<Node*> read_buffer[READ_BUFFER_SIZE] = {};
+    std::atomic<size_t> read_buffer_head{0};
+
+    CacheShard(size_t cap_bytes, const std::string& policy_name, size_t negative_entries, uint64_t negative_ttl, size_t prepared_entries)
+        : policy(makePolicy(policy_name, maxEntriesFor(cap_bytes))), negative(negative_entries), negative_ttl_ms(negative_ttl), 
+          prepared(prepared_entries), capacity_bytes(cap_bytes) {}
+
+    ~CacheShard()
+    {
+        for(auto& r : retired) slab.freeNode(r.first);
+    }
+
+    // Everything below runs under the shard mutex.
+    // A set, delete, eviction or expiry all retire the node, which also drops its prepared response.
+    void retireNode(Node* node) 
+    {
+        prepared.invalidate(node);
+        retired.emplace_back(node, g_epochs.retireEpoch()); 
+    }
+
+    // A buffered node may have been replaced or evicted since, but it is never freed before the buffer
+    // is drained: reclaim() drains first, and a reader that buffers it later holds back its epoch.
+    void drainReadBuffer()
+    {
+        for(std::atomic<Node*>& slot : read_buffer) 
+        {
+            Node* node = slot.exchange(nullptr, std::memory_order_acquire);
+            if(node == nullptr) continue;
+            policy->recordAccess(node->hash);
+            if(store.contains(node, node->hash)) policy->onHit(node);
+        }
+    }
+
+    void reclaim()
+    {
+        uint64_t safe_epoch = g_epochs.advance();
+        drainReadBuffer();
+        store.reclaim(safe_epoch);
+
+        // A reader pins before it leaves its epoch, so once the epoch is safe a pin seen here is the last word.
+        size_t kept = 0;
+        for(auto& r : retired) 
+        {
+            if(r.second < safe_epoch && !r.first->pinned()) slab.freeNode(r.first);
+            else retired[kept++] = r;
+        }
+        retired.resize(kept);
+        prepared.reclaim(safe_epoch);
+    }
+
+    // Every entry is charged its whole slab chunk plus its index slot.
+    size_t entryCharge(size_t key_len, size_t value_len, bool expires = false) const
+    {
+        return slab.chunkBytes(Node::chunkSize(key_len, value_len, expires)) + sizeof(IndexSlot);
+    }
+
+    size_t entryCharge(const Node* node) const { return entryCharge(node->key_len, node->value_len, node->hasExpiry()); }
+
+    static size_t maxEntriesFor(size_t cap_bytes) { return std::max<size_t>(1, cap_bytes / (CACHE_LINE_SIZE + sizeof(IndexSlot))); }
+};
+
+// The shard whose mutex this thread already holds for a whole batch of requests (see PerCoreServer). The
+// handlers take shard locks through lockShard() and tryLockShard(), which skip it.
+thread_local CacheShard* t_owned_shard = nullptr;
+
+std::unique_lock<std::mutex> lockShard(CacheShard& shard)
+{
+    if(&shard == t_owned_shard) return std::unique_lock<std::mutex>();
+    return std::unique_lock<std::mutex>(shard.mutex);
+}
+
+// True if the shard is this thread's now, either way.
+bool tryLockShard(CacheShard& shard, std::unique_lock<std::mutex>& lock)
+{
+    if(&shard == t_owned_shard) return true;
+    lock = std::unique_lock<std::mutex>(shard.mutex, std::try_to_lock);
+    return lock.owns_lock();
+}
+
+// Lets go of the owned shard for as long as it lives, for code that takes other shards' locks: two threads
+// each holding its own shard while waiting for the other's would deadlock.
+class OwnedShardRelease
+{
+    private:
+        CacheShard* m_shard;
+    public:
+        OwnedShardRelease() : m_shard(t_owned_shard)
+        {
+            if(m_shard == nullptr) return;
+            t_owned_shard = nullptr;
+            m_shard->mutex.unlock();
+        }
+
+        ~OwnedShardRelease()
+        {
+            if(m_shard == nullptr) return;
+            m_shard->mutex.lock();
+            t_owned_shard = m_shard;
+        }
+};
+
+uint64_t hashKey(std::string_view key)
+{
+    return std::hash<std::string_view>{}(key);
+}
+
+class ShardedCache
+{
+    private:
+        std::vector<std::unique_ptr<CacheShard>> m_shards;
+    public:
+        ShardedCache(int num_shards, size_t total_bytes, const std::string& policy_name = "lru",
+                     size_t negative_entries = DEFAULT_NEGATIVE_ENTRIES, uint64_t negative_ttl_ms = DEFAULT_NEGATIVE_TTL_MS,
+                     size_t prepared_entries = DEFAULT_PREPARED_RESPONSES)
+        {
+            if(num_shards < 1) num_shards = 1;
+
+            for(int i = 0; i < num_shards; i++) 
+            {
+                m_shards.emplace_back(new CacheShard(total_bytes / num_shards, policy_name, negative_entries / num_shards, negative_ttl_ms, prepared_entries / num_shards));
+            }
+        }
+
+        size_t size() const { return m_shards.size(); }
+
+        const char* policyName() const { return m_shards[0]->policy->name(); }
+
+        CacheShard& shard(size_t i) { return *m_shards[i]; }
+
+        size_t shardIndex(uint64_t hash) const { return (hash >> 32) % m_shards.size(); }
+
+        CacheShard& shardFor(uint64_t hash)
+        {
+            return *m_shards[shardIndex(hash)];
+        }
+};
+
+template<typename T>
+class ThreadSafeQueue 
+{
+    private:
+        std::queue<T> m_queue;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        bool m_stop = false;
+    public:
+        void push(T task) 
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push(task);
+            m_cond.notify_one();
+        }
+        // False once the queue is stopped and drained.
+        bool pop(T& task) 
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(m_stop == false && m_queue.empty()) 
+            {
+                m_cond.wait(lock);
+            }
+            if(m_stop && m_queue.empty()) return false;
+            task = m_queue.front();
+            m_queue.pop();
+            return true;
+        }
+        void stop() 
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            m_cond.notify_all();
+        }
+};
+
+// Backend binary protocol (--backend-binary, BACKEND_BINARY_PORT): a 16-byte little-endian header
+//   [0] magic  [1] opcode  [2..3] flags (request) or status code (response)
+//   [4..7] request id, echoed back  [8..11] key length  [12..15] value length
+// then the raw key and value bytes. MSET values are repeated {u32 key length, u32 value length, key,
+// value}; KEYS takes a u32 page size as its value and answers with repeated {u32 length, key}.
+enum BackendOp : uint8_t { OP_GET = 1, OP_SET = 2, OP_DELETE = 3, OP_MSET = 4, OP_KEYS = 5, OP_PING = 6 };
+
+// One backend request, independent of the protocol it goes out in.
+struct BackendCall
+{
+    BackendOp op;
+    std::string_view key = {};
+    std::string_view value = {};
+    uint32_t limit = 0;
+    bool has_after = false;
+};
+
+uint32_t get32(const char* p)
+{
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return u[0] | (u[1] << 8) | (u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+void put32(char* p, uint32_t v)
+{
+    p[0] = (char)v;
+    p[1] = (char)(v >> 8);
+    p[2] = (char)(v >> 16);
+    p[3] = (char)(v >> 24);
+}
+
+std::string statusText(uint16_t code)
+{
+    switch(code) 
+    {
+        case 200: return "200 OK";
+        case 400: return "400 Bad Request";
+        case 404: return "404 Not Found";
+        case 503: return "503 Service Unavailable";
+        default: return std::to_string(code) + " Internal Server Error";
+    }
+}
+
+// Persistent keep-alive connections to the backend, each shared by up to --backend-depth outstanding
+// requests. Requests are tagged with X-Request-Id and written back to back; a reader thread per
+// connection matches every response to its waiting request by that id, so the backend may answer them
+// in any order. A backend that does not echo the id answers in order, and each of its responses then
+// completes the oldest outstanding request. A request goes to the up connection with the fewest in
+// flight, reconnects a down one if none is up, and waits while every connection is at depth.
+//
+// When a connection breaks, its reader fails every request still outstanding on it. Reads (/db_get,
+// /db_keys, /db_ping) are sent once more on another connection, so a backend restart does not surface to
+// clients. A write is only resent if it never fully reached the socket: once sent it may still run on the
+// backend, and a second copy could land after a later write to the same key, so its failure goes back to
+// the caller (the write-back queue requeues it in order). A health thread reopens connections that are
+// down and pings those left idle for a whole interval via /db_ping.
+//
+// A backend that hangs without closing is caught by --backend-timeout: a send (or connect) that blocks
+// that long fails, and a request or ping left unanswered that long takes its connection down, which
+// fails everything outstanding on it the same way.
+//
+// With setBinary() the same requests go to BACKEND_BINARY_PORT as binary frames: a request is written
+// with one writev straight from the caller's key and value, and responses are framed by their length
+// fields instead of by searching for headers.
+//
+// requestAsync() makes the same request without blocking the caller: a dispatcher thread sends it once a
+// connection has a free slot, applies the same retries and timeout, and calls back when it is answered.
+class BackendPool
+{
+    public:
+        // Receives the status and body request() would have returned.
+        using Callback = std::function<void(std::string http_status, std::string body)>;
+
+    private:
+        struct AsyncRequest;
+
+        struct Reply
+        {
+            std::condition_variable cond;
+            bool done = false;
+            bool ok = false;
+            // The request was not completely written, so the backend cannot have run it.
+            bool unsent = false;
+            uint32_t id = 0;
+            std::string response;
+            // Set for a requestAsync() reply, which is handed to the dispatcher instead of signalled.
+            AsyncRequest* async = nullptr;
+        };
+
+        // Owned by the dispatcher from requestAsync() until its callback has run.
+        struct AsyncRequest
+        {
+            BackendOp op;
+            std::string key;
+            std::string value;
+            uint32_t limit = 0;
+            bool has_after = false;
+            Callback callback;
+            Reply reply;
+            size_t conn = 0;
+            int attempts = 0;
+            int sends = 0;
+            std::chrono::steady_clock::time_point deadline;
+
+            BackendCall call() const { return BackendCall{op, key, value, limit, has_after}; }
+        };
+
+        struct Connection
+        {
+            // Serializes writes to fd and replacing it; taken before m_mutex when both are needed.
+            std::mutex send_mutex;
+            int fd = -1;
+            bool up = false;
+            std::thread reader;
+
+            // Guarded by m_mutex. Ids fit the binary header and skip 0, which means untagged.
+            uint32_t next_id = 1;
+            std::unordered_map<uint32_t, Reply*> pending;
+            std::deque<uint32_t> sent_order;
+            long in_flight = 0;
+            long peak_in_flight = 0;
+            long requests = 0;
+            long failures = 0;
+            long reconnects = 0;
+            long health_checks = 0;
+            long timeouts = 0;
+            std::chrono::steady_clock::time_point last_used;
+        };
+
+        std::mutex m_mutex;
+        std::condition_variable m_free_cond;
+        std::condition_variable m_health_cond;
+        std::vector<std::unique_ptr<Connection>> m_conns;
+        size_t m_depth = DEFAULT_BACKEND_DEPTH;
+        long m_timeout_ms = DEFAULT_BACKEND_TIMEOUT_MS;
+        bool m_binary = false;
+        bool m_stop = false;
+        long m_waits = 0;
+        double m_wait_ms_total = 0;
+
+        // Guarded by m_mutex: async requests waiting for a slot, and those whose reply (or failure) is in.
+        std::deque<AsyncRequest*> m_async_queue;
+        std::vector<AsyncRequest*> m_async_done;
+        // Every connection was at depth when the dispatcher last tried to send; a freed slot wakes it.
+        bool m_async_full = false;
+        long m_async_requests = 0;
+        std::condition_variable m_async_cond;
+        std::thread m_async_thread;
+        // Touched by the dispatcher only.
+        std::unordered_set<AsyncRequest*> m_async_sent;
+
+        int openConnection()
+        {
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            if(fd < 0) 
+            {
+                perror("ERROR: Failed to create socket for Backend connection.");
+                return -1;
+            }
+
+            // Bounds connect() and every send; a blocked send then fails like a broken connection.
+            struct timeval timeout = {m_timeout_ms / 1000, (m_timeout_ms % 1000) * 1000};
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+            struct sockaddr_in server_address;
+            server_address.sin_family = AF_INET;
+            server_address.sin_port = htons(m_binary ? BACKEND_BINARY_PORT : BACKEND_PORT);
+            if(inet_pton(AF_INET, BACKEND_IP, &server_address.sin_addr) <= 0 || 
+               ::connect(fd, (struct sockaddr*)&server_address, sizeof(server_address)) < 0) 
+            {
+                perror("ERROR: Failed to connect to Backend DB Server.");
+                close(fd);
+                return -1;
+            }
+
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+
+        static uint32_t requestIdOf(const std::string& response, size_t header_end)
+        {
+            size_t pos = std::string_view(response).substr(0, header_end).find("X-Request-Id: ");
+            if(pos == std::string_view::npos) return 0;
+            return strtoul(response.c_str() + pos + 14, nullptr, 10);
+        }
+
+        static std::string httpRequest(const BackendCall& call, uint32_t id)
+        {
+            std::string path_and_query, body;
+            switch(call.op) 
+            {
+                case OP_GET: path_and_query = "/db_get?key=" + urlEncode(call.key); break;
+                case OP_DELETE: path_and_query = "/db_delete?key=" + urlEncode(call.key); break;
+                case OP_PING: path_and_query = "/db_ping"; break;
+                case OP_SET: 
+                    path_and_query = "/db_set";
+                    body = "key=" + urlEncode(call.key) + "&value=" + urlEncode(call.value);
+                    break;
+                case OP_MSET: 
+                    path_and_query = "/db_mset";
+                    body = call.value;
+                    break;
+                case OP_KEYS: 
+                    path_and_query = "/db_keys?limit=" + std::to_string(call.limit);
+                    if(call.has_after) path_and_query += "&after=" + urlEncode(call.key);
+                    break;
+            }
+
+            if(body.empty()) 
+            {
+                return "GET " + path_and_query + " HTTP/1.1\r\nX-Request-Id: " + std::to_string(id) + "\r\nConnection: keep-alive\r\n\r\n";
+            }
+            return "POST " + path_and_query + " HTTP/1.1\r\nX-Request-Id: " + std::to_string(id) + "\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+                   "Content-Length: " + std::to_string(body.length()) + "\r\nConnection: keep-alive\r\n\r\n" + body;
+        }
+
+        // Picks the connection for the next request: the up one with the fewest in flight below depth,
+        // else a down one to reconnect (needs_connect), else waits for a slot. Without wait it returns
+        // size() instead of waiting.
+        size_t pick(bool& needs_connect, bool wait = true)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            bool waited = false;
+            auto wait_start = std::chrono::steady_clock::now();
+            while(true) 
+            {
+                size_t best = m_conns.size(), down = m_conns.size();
+                for(size_t i = 0; i < m_conns.size(); i++) 
+                {
+                    const Connection& conn = *m_conns[i];
+                    if(!conn.up) 
+                    {
+                        if(down == m_conns.size()) down = i;
+                    }
+                    else if((size_t)conn.in_flight < m_depth && (best == m_conns.size() || conn.in_flight < m_conns[best]->in_flight)) 
+                    {
+                        best = i;
+                    }
+                }
+
+                size_t chosen = best != m_conns.size() ? best : down;
+                if(chosen != m_conns.size()) 
+                {
+                    if(waited) m_wait_ms_total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wait_start).count();
+                    needs_connect = chosen == down;
+                    return chosen;
+                }
+                if(!wait) 
+                {
+                    m_async_full = true;
+                    return m_conns.size();
+                }
+                if(!waited) m_waits++;
+                waited = true;
+                m_free_cond.wait(lock);
+            }
+        }
+
+        // Splits a complete response into its status and body.
+        std::string parseResponse(std::string& response, std::string& http_status) const
+        {
+            if(m_binary) 
+            {
+                http_status = statusText((unsigned char)response[2] | ((unsigned char)response[3] << 8));
+                response.erase(0, BINARY_HEADER_SIZE);
+                return std::move(response);
+            }
+
+            size_t status_end = response.find("\r\n");
+            if(response.compare(0, 9, "HTTP/1.1 ") != 0 || status_end == std::string::npos) 
+            {
+                http_status = "500 Internal Server Error";
+                return "Error: Malformed response from Backend.";
+            }
+            http_status = response.substr(9, status_end - 9);
+            return getResponseBody(response);
+        }
+
+        // Reopens connection i if it is down. Returns whether it is up.
+        bool ensureConnected(size_t i, bool count_reconnect = true)
+        {
+            Connection& conn = *m_conns[i];
+            std::lock_guard<std::mutex> send_lock(conn.send_mutex);
+            if(conn.up) return true;
+            // A reader marks its connection down as the last thing it does.
+            if(conn.reader.joinable()) conn.reader.join();
+
+            int fd = openConnection();
+            if(fd == -1) return false;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            conn.fd = fd;
+            conn.up = true;
+            conn.last_used = std::chrono::steady_clock::now();
+            if(count_reconnect) conn.reconnects++;
+            conn.reader = std::thread(&BackendPool::readerLoop, this, i, fd);
+            m_free_cond.notify_all();
+            slotFreed();
+            return true;
+        }
+
+        // Registers reply and writes the request. False if the connection went down before it could be
+        // sent; a failure after that completes reply with ok = false.
+        bool submit(size_t i, const BackendCall& call, Reply& reply)
+        {
+            Connection& conn = *m_conns[i];
+            std::lock_guard<std::mutex> send_lock(conn.send_mutex);
+            uint32_t id;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(!conn.up) return false;
+                id = conn.next_id++;
+                if(conn.next_id == 0) conn.next_id = 1;
+                reply.id = id;
+                conn.pending[id] = &reply;
+                conn.sent_order.push_back(id);
+                conn.in_flight++;
+                conn.requests++;
+                conn.peak_in_flight = std::max(conn.peak_in_flight, conn.in_flight);
+            }
+
+            bool sent;
+            if(m_binary) 
+            {
+                char limit[4];
+                put32(limit, call.limit);
+                std::string_view value = call.op == OP_KEYS ? std::string_view(limit, 4) : call.value;
+                char header[BINARY_HEADER_SIZE];
+                header[0] = (char)BINARY_MAGIC;
+                header[1] = (char)call.op;
+                header[2] = call.has_after ? BINARY_FLAG_AFTER : 0;
+                header[3] = 0;
+                put32(header + 4, id);
+                put32(header + 8, call.key.size());
+                put32(header + 12, value.size());
+                struct iovec iov[3] = {{header, BINARY_HEADER_SIZE}, {(void*)call.key.data(), call.key.size()}, {(void*)value.data(), value.size()}};
+                sent = sendAll(conn.fd, iov, 3);
+            }
+            else 
+            {
+                std::string http_request = httpRequest(call, id);
+                struct iovec iov[1] = {{(void*)http_request.data(), http_request.length()}};
+                sent = sendAll(conn.fd, iov, 1);
+            }
+
+            if(!sent) 
+            {
+                reply.unsent = true;
+                perror("ERROR: Send to Backend failed");
+                // The reader sees the connection end and fails everything outstanding on it, this included.
+                shutdown(conn.fd, SHUT_RDWR);
+            }
+            return true;
+        }
+
+        // Under m_mutex, once reply is done: wakes its waiter, or hands it to the dispatcher.
+        void notifyDone(Reply& reply)
+        {
+            if(reply.async == nullptr) 
+            {
+                reply.cond.notify_one();
+                return;
+            }
+            m_async_done.push_back(reply.async);
+            m_async_cond.notify_one();
+        }
+
+        // Under m_mutex, when a connection may have room again.
+        void slotFreed()
+        {
+            if(!m_async_full) return;
+            m_async_full = false;
+            m_async_cond.notify_one();
+        }
+
+        void complete(Connection& conn, uint32_t id, std::string&& response)
+        {
+            auto it = conn.pending.find(id);
+            if(it == conn.pending.end()) return;
+            Reply* reply = it->second;
+            conn.pending.erase(it);
+            if(!conn.sent_order.empty() && conn.sent_order.front() == id) conn.sent_order.pop_front();
+            else conn.sent_order.erase(std::find(conn.sent_order.begin(), conn.sent_order.end(), id));
+            conn.in_flight--;
+            conn.last_used = std::chrono::steady_clock::now();
+
+            reply->response = std::move(response);
+            reply->ok = true;
+            reply->done = true;
+            notifyDone(*reply);
+            m_free_cond.notify_one();
+            slotFreed();
+        }
+
+        void readerLoop(size_t i, int fd)
+        {
+            Connection& conn = *m_conns[i];
+            char buffer[BUFFER_SIZE];
+            std::string stream;
+            // How far the search for the end of the next response's headers got, so a large response is
+            // not searched again from the start after every read.
+            size_t scanned = 0;
+
+            while(true) 
+            {
+                size_t total = 0;
+                uint32_t id = 0;
+                if(m_binary) 
+                {
+                    if(stream.length() >= BINARY_HEADER_SIZE) 
+                    {
+                        uint64_t frame = BINARY_HEADER_SIZE + (uint64_t)get32(&stream[8]) + get32(&stream[12]);
+                        if((unsigned char)stream[0] != BINARY_MAGIC || frame > BINARY_MAX_FRAME) 
+                        {
+                            std::cerr << "[ERROR] Malformed binary frame from Backend." << std::endl;
+                            break;
+                        }
+                        if(stream.length() >= frame) 
+                        {
+                            total = frame;
+                            id = get32(&stream[4]);
+                        }
+                        else 
+                        {
+                            stream.reserve(frame);
+                        }
+                    }
+                }
+                else 
+                {
+                    size_t header_end = stream.find("\r\n\r\n", std::max<size_t>(scanned, 3) - 3);
+                    scanned = header_end == std::string::npos ? stream.length() : header_end;
+                    if(header_end != std::string::npos) 
+                    {
+                        size_t length = header_end + 4 + contentLength(stream, header_end);
+                        if(stream.length() >= length) 
+                        {
+                            total = length;
+                            id = requestIdOf(stream, header_end);
+                        }
+                    }
+                }
+
+                if(total > 0) 
+                {
+                    scanned = 0;
+                    // A read holding exactly one response hands its buffer over whole.
+                    std::string response;
+                    if(stream.length() == total) 
+                    {
+                        response = std::move(stream);
+                        stream = std::string();
+                    }
+                    else 
+                    {
+                        response = stream.substr(0, total);
+                        stream.erase(0, total);
+                    }
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if(id == 0 && !conn.sent_order.empty()) id = conn.sent_order.front();
+                    complete(conn, id, std::move(response));
+                    continue;
+                }
+
+                int bytes_read = read(fd, buffer, BUFFER_SIZE);
+                if(bytes_read <= 0) break;
+                stream.append(buffer, bytes_read);
+            }
+
+            std::lock_guard<std::mutex> send_lock(conn.send_mutex);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            close(fd);
+            conn.fd = -1;
+            conn.up = false;
+            conn.failures += conn.pending.size();
+            for(auto& entry : conn.pending) 
+            {
+                entry.second->done = true;
+                notifyDone(*entry.second);
+            }
+            conn.pending.clear();
+            conn.sent_order.clear();
+            conn.in_flight = 0;
+            m_free_cond.notify_all();
+            slotFreed();
+            if(!m_stop) std::cerr << "[WARN] Backend connection " << i << " lost." << std::endl;
+        }
+
+        // Shuts connection i down if reply is still outstanding on it; its reader then fails everything
+        // outstanding on it, this reply included.
+        void timeOut(size_t i, const Reply& reply)
+        {
+            Connection& conn = *m_conns[i];
+            std::lock_guard<std::mutex> send_lock(conn.send_mutex);
+            std::lock_guard<std::mutex> pool_lock(m_mutex);
+            // Still pending means the connection it was sent on has not been torn down yet.
+            auto it = conn.pending.find(reply.id);
+            if(conn.up && it != conn.pending.end() && it->second == &reply) 
+            {
+                conn.timeouts++;
+                std::cerr << "[WARN] Backend connection " << i << " sent no reply within " << m_timeout_ms << " ms, dropping it." << std::endl;
+                shutdown(conn.fd, SHUT_RDWR);
+            }
+        }
+
+        // Waits for a reply submitted on connection i, timing it out past the deadline.
+        void awaitReply(size_t i, Reply& reply)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if(reply.cond.wait_for(lock, std::chrono::milliseconds(m_timeout_ms), [&]() { return reply.done; })) return;
+            lock.unlock();
+            timeOut(i, reply);
+            lock.lock();
+            reply.cond.wait(lock, [&]() { return reply.done; });
+        }
+
+        // Dispatcher only, without m_mutex.
+        void finishAsync(AsyncRequest* request)
+        {
+            std::string http_status, body;
+            if(!request->reply.ok) 
+            {
+                http_status = "503 Service Unavailable";
+                body = "ERROR: Failed to reach the Backend DB Server.";
+            }
+            else body = parseResponse(request->reply.response, http_status);
+            request->callback(std::move(http_status), std::move(body));
+            delete request;
+        }
+
+        // After a failed try: queues the request to go again if request() would have sent it again, else fails it.
+        void retryOrFail(AsyncRequest* request, bool may_have_run)
+        {
+            if(may_have_run || request->attempts >= 4 || request->sends >= 2) 
+            {
+                finishAsync(request);
+                return;
+            }
+            Reply& reply = request->reply;
+            reply.done = reply.ok = reply.unsent = false;
+            reply.response.clear();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_async_queue.push_front(request);
+        }
+
+        // Sends queued async requests until the queue is empty or every connection is at depth.
+        void sendQueued()
+        {
+            while(true) 
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if(m_async_queue.empty()) return;
+                }
+                bool needs_connect = false;
+                size_t i = pick(needs_connect, false);
+                if(i == m_conns.size()) return;
+
+                // Only the dispatcher takes from the queue, so its front is still the one seen above.
+                AsyncRequest* request;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    request = m_async_queue.front();
+                    m_async_queue.pop_front();
+                }
+                request->attempts++;
+                request->conn = i;
+                if(needs_connect && !ensureConnected(i)) 
+                {
+                    request->sends++;
+                    retryOrFail(request, false);
+                    continue;
+                }
+                if(!submit(i, request->call(), request->reply)) 
+                {
+                    retryOrFail(request, false);
+                    continue;
+                }
+                request->sends++;
+                request->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_timeout_ms);
+                m_async_sent.insert(request);
+            }
+        }
+
+        // The dispatcher: sends async requests, times them out, retries them under request()'s rules and calls
+        // back. It runs until stop(), and past it until everything queued or sent has been answered.
+        void asyncLoop()
+        {
+            std::vector<AsyncRequest*> done, expired;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(!m_stop || !m_async_queue.empty() || !m_async_sent.empty()) 
+            {
+                m_async_cond.wait_for(lock, std::chrono::milliseconds(BACKEND_ASYNC_TICK_MS), [&]() 
+                {
+                    return !m_async_done.empty() || (!m_async_queue.empty() && !m_async_full) || (m_stop && m_async_queue.empty() && m_async_sent.empty());
+                });
+                done.clear();
+                done.swap(m_async_done);
+                expired.clear();
+                auto now = std::chrono::steady_clock::now();
+                for(AsyncRequest* request : m_async_sent) 
+                {
+                    if(!request->reply.done && request->deadline < now) expired.push_back(request);
+                }
+                lock.unlock();
+
+                for(AsyncRequest* request : expired) 
+                {
+                    request->deadline = std::chrono::steady_clock::time_point::max();
+                    timeOut(request->conn, request->reply);
+                }
+                for(AsyncRequest* request : done) 
+                {
+                    m_async_sent.erase(request);
+                    bool idempotent = request->op == OP_GET || request->op == OP_KEYS || request->op == OP_PING;
+                    if(request->reply.ok) finishAsync(request);
+                    else retryOrFail(request, !idempotent && !request->reply.unsent);
+                }
+                sendQueued();
+                lock.lock();
+            }
+        }
+
+        // One round trip on connection i; false if it failed, timed out or the connection was down.
+        bool roundTrip(size_t i, const BackendCall& call, std::string& response)
+        {
+            Reply reply;
+            if(!submit(i, call, reply)) return false;
+            awaitReply(i, reply);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            response = std::move(reply.response);
+            return reply.ok;
+        }
+
+    public:
+        ~BackendPool() 
+        { 
+            stop();
+            closeAll(); 
+        }
+
+        // Only before connect().
+        void setSize(size_t n) 
+        { 
+            m_conns.clear();
+            for(size_t i = 0; i < std::max<size_t>(1, n); i++) m_conns.emplace_back(new Connection());
+        }
+
+        void setDepth(size_t depth) { m_depth = std::max<size_t>(1, depth); }
+
+        // Only before connect().
+        void setTimeout(long timeout_ms) { m_timeout_ms = std::max<long>(1, timeout_ms); }
+
+        // Only before connect().
+        void setBinary(bool binary) { m_binary = binary; }
+
+        bool binary() const { return m_binary; }
+
+        // Appends one key/value pair to an OP_MSET payload in this pool's encoding.
+        void appendPair(std::string& payload, std::string_view key, std::string_view value) const
+        {
+            if(m_binary) 
+            {
+                char lengths[8];
+                put32(lengths, key.size());
+                put32(lengths + 4, value.size());
+                payload.append(lengths, 8);
+                payload.append(key);
+                payload.append(value);
+                return;
+            }
+            if(!payload.empty()) payload += '&';
+            payload += urlEncode(key) + "=" + urlEncode(value);
+        }
+
+        size_t size() const { return m_conns.size(); }
+
+        // Opens every connection; returns how many are up. The rest are retried by the health check.
+        size_t connect()
+        {
+            if(m_conns.empty()) setSize(DEFAULT_BACKEND_CONNS);
+            size_t up = 0;
+            for(size_t i = 0; i < m_conns.size(); i++) 
+            {
+                if(ensureConnected(i, false)) up++;
+            }
+            if(!m_async_thread.joinable()) m_async_thread = std::thread(&BackendPool::asyncLoop, this);
+            return up;
+        }
+
+        std::string request(const BackendCall& call, std::string& http_status)
+        {
+            std::string response;
+            bool ok = false;
+            bool idempotent = call.op == OP_GET || call.op == OP_KEYS || call.op == OP_PING;
+            bool may_have_run = false;
+            // Up to two sends; a connection found down before sending does not use one up. A write that may
+            // have reached the backend is not sent again.
+            for(int attempt = 0, sends = 0; attempt < 4 && sends < 2 && !ok && !may_have_run; attempt++) 
+            {
+                bool needs_connect = false;
+                size_t i = pick(needs_connect);
+                if(needs_connect && !ensureConnected(i)) 
+                {
+                    sends++;
+                    continue;
+                }
+
+                Reply reply;
+                if(!submit(i, call, reply)) continue;
+                sends++;
+
+                awaitReply(i, reply);
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ok = reply.ok;
+                response = std::move(reply.response);
+                may_have_run = !ok && !idempotent && !reply.unsent;
+            }
+
+            if(!ok) 
+            {
+                http_status = "503 Service Unavailable";
+                return "ERROR: Failed to reach the Backend DB Server.";
+            }
+            return parseResponse(response, http_status);
+        }
+
+        // Like request(), but returns at once; callback runs on the dispatcher thread once the request is
+        // answered or has failed for good. Only between connect() and stop().
+        void requestAsync(const BackendCall& call, Callback callback)
+        {
+            AsyncRequest* request = new AsyncRequest();
+            request->op = call.op;
+            request->key.assign(call.key);
+            request->value.assign(call.value);
+            request->limit = call.limit;
+            request->has_after = call.has_after;
+            request->callback = std::move(callback);
+            request->reply.async = request;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_async_queue.push_back(request);
+            m_async_requests++;
+            m_async_cond.notify_one();
+        }
+
+        void healthLoop()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(true) 
+            {
+                m_health_cond.wait_for(lock, std::chrono::milliseconds(BACKEND_HEALTH_INTERVAL_MS), [&]() { return m_stop; });
+                if(m_stop) return;
+                auto stale = std::chrono::steady_clock::now() - std::chrono::milliseconds(BACKEND_HEALTH_INTERVAL_MS);
+
+                for(size_t i = 0; i < m_conns.size(); i++) 
+                {
+                    Connection& conn = *m_conns[i];
+                    bool up = conn.up;
+                    if(up && (conn.in_flight > 0 || conn.last_used > stale)) continue;
+                    conn.health_checks++;
+                    lock.unlock();
+
+                    std::string response, ping_status;
+                    if(!up) 
+                    {
+                        ensureConnected(i);
+                    }
+                    else if(!roundTrip(i, BackendCall{OP_PING}, response) || parseResponse(response, ping_status) != "PONG") 
+                    {
+                        // Its reader takes it down; the next request or round reopens it.
+                        std::cerr << "[WARN] Backend connection " << i << " failed its health check, dropping it." << std::endl;
+                        std::lock_guard<std::mutex> send_lock(conn.send_mutex);
+                        if(conn.up) shutdown(conn.fd, SHUT_RDWR);
+                    }
+                    lock.lock();
+                }
+            }
+        }
+
+        // Every requestAsync() callback has run once this returns.
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+                m_health_cond.notify_all();
+                m_async_cond.notify_all();
+            }
+            if(m_async_thread.joinable()) m_async_thread.join();
+        }
+
+        // After every user of the pool is gone.
+        void closeAll()
+        {
+            for(std::unique_ptr<Connection>& conn : m_conns) 
+            {
+                {
+                    std::lock_guard<std::mutex> send_lock(conn->send_mutex);
+                    if(conn->up) shutdown(conn->fd, SHUT_RDWR);
+                }
+                if(conn->reader.joinable()) conn->reader.join();
+            }
+        }
+
+        std::string describe()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::ostringstream out;
+            size_t up = 0;
+            long in_flight = 0;
+            for(const std::unique_ptr<Connection>& conn : m_conns) 
+            {
+                if(conn->up) up++;
+                in_flight += conn->in_flight;
+            }
+            out << "Backend pool: " << (m_binary ? "binary" : "HTTP") << ", " << up << "/" << m_conns.size() << " connections up, depth " << m_depth << ", " << in_flight << " requests in flight, "
+                << m_waits << " waits for a free slot (" << (m_waits > 0 ? m_wait_ms_total / m_waits : 0.0) << " ms avg), " << m_async_requests << " requests made without blocking the caller\n";
+            for(size_t i = 0; i < m_conns.size(); i++) 
+            {
+                const Connection& conn = *m_conns[i];
+                out << "Backend conn " << i << ": " << (conn.up ? "up" : "down") << ", " << conn.in_flight << " in flight (peak " << conn.peak_in_flight << "), " 
+                    << conn.requests << " requests, " << conn.failures << " failed, " << conn.reconnects << " reconnects, " << conn.health_checks << " health checks, " << conn.timeouts << " timeouts\n";
+            }
+            return out.str();
+        }
+};
+
+BackendPool g_backend_pool;
+
+std::string sendToBackend(const BackendCall& call, std::string& http_status)
+{
+    return g_backend_pool.request(call, http_status);
+}
+
+struct BatchedWrite
+{
+    std::string key;
+    std::string value;
+    uint64_t version;
+};
+
+// Writes a whole batch with one /db_mset round trip (one upsert statement on the backend).
+bool writeToBackendDB(const std::vector<BatchedWrite>& batch, std::string& http_status)
+{
+    std::cout << "[INFO] Writing " << batch.size() << " dirty keys to Backend DB on eviction/flush." << std::endl;
+
+    std::string body;
+    for(const BatchedWrite& w : batch) g_backend_pool.appendPair(body, w.key, w.value);
+
+    std::string backend_response = sendToBackend(BackendCall{OP_MSET, {}, body}, http_status);
+
+    if (http_status.rfind("200 OK", 0) == 0)
+    {
+        return true;
+    }
+    std::cerr << "[ERROR] Backend Write Failed (" << http_status << "): " << backend_response << std::endl;
+    return false;
+}
+
+// Dirty values leaving the cache (evicted, expired, or flushed at shutdown) are queued here instead of
+// being written to the backend while a shard lock is held. Flusher threads drain the queue in order.
+// A key that is queued again before it is written only has its value replaced, and a key is never in
+// flight on two flushers at once, so the backend always ends up with the newest value. A value the
+// backend keeps refusing is dropped after WRITEBACK_MAX_ATTEMPTS, and every dropped key is logged.
+class WriteBackQueue
+{
+    private:
+        struct PendingWrite
+        {
+            std::string value;
+            uint64_t version = 0;
+            int attempts = 0;
+            bool queued = false;
+            bool in_flight = false;
+            std::chrono::steady_clock::time_point enqueued_at;
+        };
+
+        std::mutex m_mutex;
+        std::condition_variable m_work_cond;
+        std::condition_variable m_done_cond;
+        std::deque<std::string> m_order;
+        std::unordered_map<std::string, PendingWrite> m_pending;
+        size_t m_capacity;
+        // Slots held by requests between reserve() and release(); they count against the capacity.
+        size_t m_reserved = 0;
+        bool m_stop = false;
+
+        size_t m_peak_depth = 0;
+        long m_enqueued = 0;
+        long m_coalesced = 0;
+        long m_flushed = 0;
+        long m_failed = 0;
+        long m_dropped = 0;
+        long m_batches = 0;
+        long m_backpressure_waits = 0;
+        double m_wait_ms_total = 0;
+        double m_flush_ms_total = 0;
+        double m_flush_ms_max = 0;
+
+        // Backpressure: blocks while the queue and the slots already reserved fill it, then takes a slot
+        // in the same critical section, so concurrent producers cannot all pass the check and overshoot.
+        void reserve()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if(m_pending.size() + m_reserved >= m_capacity && !m_stop) 
+            {
+                m_backpressure_waits++;
+                m_done_cond.wait(lock, [&]() { return m_pending.size() + m_reserved < m_capacity || m_stop; });
+            }
+            m_reserved++;
+        }
+
+        void release()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_reserved--;
+            m_done_cond.notify_all();
+        }
+
+    public:
+        explicit WriteBackQueue(size_t capacity) : m_capacity(capacity) {}
+
+        // Holds a queue slot for a request that may evict (or queue) a dirty value, from before it takes
+        // its shard lock until it is done with it. Callers must not hold a shard lock when creating one.
+        class Reservation
+        {
+            private:
+                WriteBackQueue* m_queue;
+            public:
+                explicit Reservation(WriteBackQueue& queue, bool needed = true) : m_queue(needed ? &queue : nullptr) 
+                {
+                    if(m_queue != nullptr) m_queue->reserve();
+                }
+                ~Reservation() { if(m_queue != nullptr) m_queue->release(); }
+                Reservation(const Reservation&) = delete;
+                Reservation& operator=(const Reservation&) = delete;
+        };
+
+        void setCapacity(size_t capacity)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_capacity = std::max<size_t>(1, capacity);
+        }
+
+        // Called under a shard lock, so it never blocks; producers take a Reservation first.
+        void enqueue(std::string_view key, std::string_view value)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            PendingWrite& pw = m_pending[std::string(key)];
+            if(pw.version > 0) m_coalesced++;
+            else pw.enqueued_at = std::chrono::steady_clock::now();
+            pw.value.assign(value);
+            pw.version++;
+            pw.attempts = 0;
+            m_enqueued++;
+            if(!pw.queued && !pw.in_flight) 
+            {
+                m_order.emplace_back(key);
+                pw.queued = true;
+                m_work_cond.notify_one();
+            }
+            m_peak_depth = std::max(m_peak_depth, m_pending.size());
+        }
+
+        // Read-your-writes for keys that already left the cache but are not in the backend yet.
+        bool lookup(const std::string& key, std::string& value_out)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_pending.find(key);
+            if(it == m_pending.end()) return false;
+            value_out = it->second.value;
+            return true;
+        }
+
+        // Every key with a write still pending, in flight ones included.
+        void forEachKey(const std::function<void(const std::string&)>& fn)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for(const auto& entry : m_pending) fn(entry.first);
+        }
+
+        // Drops the pending write of a deleted key. Waits out a write already in flight, so a following
+        // /db_delete cannot be overtaken by it. Returns true if a write was pending.
+        bool cancel(const std::string& key)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            auto it = m_pending.find(key);
+            if(it == m_pending.end()) return false;
+            while(it != m_pending.end() && it->second.in_flight) 
+            {
+                m_done_cond.wait(lock);
+                it = m_pending.find(key);
+            }
+            if(it != m_pending.end()) m_pending.erase(it);
+            m_done_cond.notify_all();
+            return true;
+        }
+
+        void flusherLoop()
+        {
+            std::vector<BatchedWrite> batch;
+            std::vector<std::string> dropped;
+            int failed_in_a_row = 0;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(true) 
+            {
+                m_work_cond.wait(lock, [&]() { return m_stop || !m_order.empty(); });
+                if(m_order.empty()) return;
+
+                // Ships when a full batch is queued or the linger time ran out, whichever comes first.
+                if(m_order.size() < WRITEBACK_BATCH && !m_stop) 
+                {
+                    m_work_cond.wait_for(lock, std::chrono::milliseconds(WRITEBACK_LINGER_MS), [&]() { 
+                        return m_stop || m_order.size() >= WRITEBACK_BATCH; 
+                    });
+                }
+
+                auto started = std::chrono::steady_clock::now();
+                batch.clear();
+                size_t batch_bytes = 0;
+                while(!m_order.empty() && batch.size() < WRITEBACK_BATCH && batch_bytes < WRITEBACK_BATCH_BYTES) 
+                {
+                    std::string key = std::move(m_order.front());
+                    m_order.pop_front();
+                    auto it = m_pending.find(key);
+                    if(it == m_pending.end() || it->second.in_flight) continue;
+
+                    PendingWrite& pw = it->second;
+                    pw.queued = false;
+                    pw.in_flight = true;
+                    m_wait_ms_total += std::chrono::duration<double, std::milli>(started - pw.enqueued_at).count();
+                    batch_bytes += key.size() + pw.value.size();
+                    batch.push_back(BatchedWrite{std::move(key), pw.value, pw.version});
+                }
+                if(batch.empty()) continue;
+                lock.unlock();
+
+                std::string http_status = "200 OK";
+                bool ok = writeToBackendDB(batch, http_status);
+                auto finished = std::chrono::steady_clock::now();
+
+                lock.lock();
+                if(ok) 
+                {
+                    double flush_ms = std::chrono::duration<double, std::milli>(finished - started).count();
+                    m_flushed += batch.size();
+                    m_batches++;
+                    m_flush_ms_total += flush_ms;
+                    m_flush_ms_max = std::max(m_flush_ms_max, flush_ms);
+                }
+                else 
+                {
+                    m_failed += batch.size();
+                }
+
+                dropped.clear();
+                for(const BatchedWrite& w : batch) 
+                {
+                    auto it = m_pending.find(w.key);
+                    if(it == m_pending.end()) continue;
+
+                    PendingWrite& pw = it->second;
+                    pw.in_flight = false;
+                    if(!ok && pw.version == w.version) pw.attempts++;
+                    bool give_up = !ok && (m_stop || pw.attempts >= WRITEBACK_MAX_ATTEMPTS);
+                    if((ok && pw.version == w.version) || give_up) 
+                    {
+                        if(give_up) dropped.push_back(w.key);
+                        m_pending.erase(it);
+                    }
+                    else 
+                    {
+                        // Newer value arrived while this one was in flight, or the write failed: go again.
+                        if(ok) it->second.enqueued_at = finished;
+                        if(!it->second.queued) 
+                        {
+                            m_order.push_back(w.key);
+                            it->second.queued = true;
+                        }
+                    }
+                }
+                m_done_cond.notify_all();
+
+                if(!dropped.empty()) 
+                {
+                    m_dropped += dropped.size();
+                    std::ostringstream keys;
+                    for(size_t i = 0; i < dropped.size() && i < 10; i++) keys << (i > 0 ? ", " : "") << dropped[i];
+                    if(dropped.size() > 10) keys << ", ...";
+                    std::cerr << "[ERROR] Dropped " << dropped.size() << " dirty keys the backend would not take " 
+                              << (m_stop ? "during shutdown" : "after " + std::to_string(WRITEBACK_MAX_ATTEMPTS) + " attempts") 
+                              << "; their latest values are lost: " << keys.str() << std::endl;
+                }
+
+                failed_in_a_row = ok ? 0 : failed_in_a_row + 1;
+                if(!ok && !m_stop) 
+                {
+                    int backoff_ms = std::min(WRITEBACK_RETRY_MAX_MS, WRITEBACK_RETRY_MS << std::min(failed_in_a_row - 1, 16));
+                    lock.unlock();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+                    lock.lock();
+                }
+            }
+        }
+
+        // Blocks until every queued write has reached the backend or been dropped.
+        void drain()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done_cond.wait(lock, [&]() { return m_pending.empty(); });
+        }
+
+        // Flushers finish what is queued, then exit. Writes that fail from here on are dropped (and logged).
+        void stop()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            m_work_cond.notify_all();
+            m_done_cond.notify_all();
+        }
+
+        long dropped()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_dropped;
+        }
+
+        std::string describe()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::ostringstream out;
+            out << "Write-back queue: " << m_pending.size() << "/" << m_capacity << " keys pending (peak " << m_peak_depth << "), "
+                << m_enqueued << " enqueued, " << m_coalesced << " coalesced, " << m_flushed << " flushed, " << m_failed << " failed, " << m_dropped << " dropped, "
+                << m_backpressure_waits << " backpressure waits\n";
+            out << "Write-back batches: " << m_batches << " /db_mset round trips, " << (m_batches > 0 ? (double)m_flushed / m_batches : 0.0) << " keys/batch avg\n";
+            out << "Write-back latency: " << (m_flushed > 0 ? m_wait_ms_total / m_flushed : 0.0) << " ms avg queued, "
+                << (m_batches > 0 ? m_flush_ms_total / m_batches : 0.0) << " ms avg batch flush, " << m_flush_ms_max << " ms max batch flush\n";
+            return out.str();
+        }
+};
+
+WriteBackQueue g_writeback(DEFAULT_WRITEBACK_QUEUE);
+
+// Builds a fresh key filter and swaps it in. Sets that land meanwhile go into the new table directly, so
+// only keys that existed before it started have to be found: in a cache shard, in the write-back queue
+// or in the backend (/db_keys, page by page). They are scanned in that order, the order a key moves in
+// (evicted into the queue, then flushed to the backend), so a key moving mid-scan is still seen. Keys
+// are streamed straight into the table, which is sized from expected_keys; one that turns out too small
+// is rebuilt again once its FPR passes the design point. False, with the old filter kept, if the backend
+// cannot list its keys. cache is null for the startup load, before the cache exists.
+bool buildKeyFilter(ShardedCache* cache, size_t expected_keys)
+{
+    auto build_start = std::chrono::steady_clock::now();
+    g_key_filter.beginBuild(expected_keys);
+    long listed = 0;
+
+    if(cache != nullptr) 
+    {
+        for(size_t i = 0; i < cache->size(); i++) 
+        {
+            CacheShard& shard = cache->shard(i);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.policy->forEach([](Node* node) { g_key_filter.addToBuild(node->hash); });
+        }
+    }
+    g_writeback.forEachKey([](const std::string& key) { g_key_filter.addToBuild(hashKey(key)); });
+
+    std::string after;
+    bool first_page = true;
+    while(true) 
+    {
+        std::string backend_status = "200 OK";
+        BackendCall call{OP_KEYS, after};
+        call.limit = KEY_FILTER_PAGE;
+        call.has_after = !first_page;
+        std::string page = sendToBackend(call, backend_status);
+        if(backend_status.rfind("200 OK", 0) != 0 || (cache != nullptr && g_shutdown_flag)) 
+        {
+            std::cerr << "[WARN] Backend could not list its keys (" << backend_status << "). Key filter " << (g_key_filter.ready() ? "not rebuilt." : "disabled.") << std::endl;
+            g_key_filter.abortBuild();
+            return false;
+        }
+        first_page = false;
+        if(page.empty()) break;
+
+        size_t pos = 0;
+        while(pos < page.length()) 
+        {
+            if(g_backend_pool.binary()) 
+            {
+                uint32_t length = pos + 4 <= page.length() ? get32(&page[pos]) : 0;
+                if(pos + 4 + length > page.length()) break;
+                after.assign(page, pos + 4, length);
+                pos += 4 + length;
+            }
+            else 
+            {
+                size_t end = page.find('\n', pos);
+                if(end == std::string::npos) end = page.length();
+                after = urlDecode(page.substr(pos, end - pos));
+                pos = end + 1;
+            }
+            g_key_filter.addToBuild(hashKey(after));
+            listed++;
+        }
+    }
+    g_key_filter.finishBuild();
+
+    auto build_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - build_start).count();
+    std::cout << "[INFO] Key filter built with " << listed << " backend keys in " << build_ms << " ms, sized for " << expected_keys << " keys." << std::endl;
+    return true;
+}
+
+// Rebuilds the key filter in the background once deletes or new keys have worn it down.
+void key_filter_function(ShardedCache& cache, size_t min_keys)
+{
+    while(!g_shutdown_flag) 
+    {
+        for(int waited = 0; waited < KEY_FILTER_CHECK_MS && !g_shutdown_flag; waited += 100) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        if(g_shutdown_flag || !g_key_filter.needsRebuild(KEY_FILTER_MIN_REBUILD_DELETES)) continue;
+        // Room for the key count to double again before the FPR reaches its design point.
+        buildKeyFilter(&cache, std::max(min_keys, 2 * g_key_filter.estimatedKeys()));
+    }
+}
+
+// Hands a dirty node's value to the write-back queue; the node itself may be dropped right after.
+void queueWriteBack(Node* node)
+{
+    if(!node->isDirty()) return;
+    g_writeback.enqueue(node->key(), node->value());
+    node->setDirty(false);
+}
+
+// Unlinks the node; its chunk is freed by a later reclaim, once no lock-free reader can still hold it.
+void releaseNode(CacheShard& shard, Node* node)
+{
+    shard.bytes_used -= shard.entryCharge(node);
+    shard.store.erase(node);
+    shard.retireNode(node);
+    shard.count_of_pairs--;
+    if(shard.retired.size() >= CacheShard::RECLAIM_BATCH) shard.reclaim();
+}
+
+bool evictOne(CacheShard& shard, uint64_t incoming_hash)
+{
+    Node* node_to_evict = shard.policy->victim(incoming_hash);
+    if(node_to_evict == nullptr) return false;
+    //std::cout << "[INFO] Cache full. Evicting key: " << node_to_evict->key() << std::endl;
+    queueWriteBack(node_to_evict);
+    shard.policy->onEvict(node_to_evict);
+    releaseNode(shard, node_to_evict);
+    return true;
+}
+
+// Evicts until an entry of the given charge fits in the shard's byte budget. Returns false if the entry
+// is larger than the whole budget and should not be cached at all.
+bool makeRoom(CacheShard& shard, size_t charge, uint64_t incoming_hash)
+{
+    if(charge > shard.capacity_bytes) return false;
+
+    bool evicted = false;
+    while(shard.bytes_used + charge > shard.capacity_bytes && evictOne(shard, incoming_hash)) evicted = true;
+    if(evicted) shard.policy->setCapacityHint(shard.count_of_pairs + 1);
+    return true;
+}
+
+Node* insertNode(CacheShard& shard, const std::string& key, std::string_view value, uint64_t hash, bool dirty, uint64_t expire_at = 0)
+{
+    Node* newNode = shard.slab.allocNode(key, value, expire_at);
+    newNode->hash = hash;
+    newNode->setDirty(dirty);
+    shard.policy->onInsert(newNode);
+    shard.store.insert(newNode);
+    shard.count_of_pairs++;
+    shard.bytes_used += shard.entryCharge(newNode);
+    if(expire_at != 0) shard.wheel.schedule(newNode, nowMs());
+    return newNode;
+}
+
+Node* replaceNode(CacheShard& shard, Node* old_node, std::string_view value, uint64_t expire_at = 0)
+{
+    Node* replacement = shard.slab.allocNode(old_node->key(), value, expire_at);
+    replacement->hash = old_node->hash;
+    replacement->setDirty(old_node->isDirty());
+    shard.policy->onReplace(old_node, replacement);
+
+    shard.bytes_used += shard.entryCharge(replacement);
+    shard.bytes_used -= shard.entryCharge(old_node);
+    shard.store.replace(old_node, replacement);
+    shard.retireNode(old_node);
+    if(expire_at != 0) shard.wheel.schedule(replacement, nowMs());
+    if(shard.retired.size() >= CacheShard::RECLAIM_BATCH) shard.reclaim();
+    return replacement;
+}
+
+// A response body: bytes the handler produced, or a cached value sent straight from its node or from its
+// prepared response, either of which stays referenced until the body is dropped after the write.
+class ResponseBody
+{
+    private:
+        std::string m_owned;
+        Node* m_node = nullptr;
+        PreparedResponse* m_prepared = nullptr;
+
+    public:
+        ResponseBody() = default;
+        ResponseBody(std::string owned) : m_owned(std::move(owned)) {}
+        ResponseBody(const char* owned) : m_owned(owned) {}
+
+        // Points into the node, or copies its value if the node already has as many pins as it can hold.
+        static ResponseBody fromNode(Node* node)
+        {
+            ResponseBody body;
+            if(node->pin()) body.m_node = node;
+            else 
+            {
+                g_pin_saturated++;
+                body.m_owned.assign(node->value());
+            }
+            return body;
+        }
+
+        // Inside an EpochGuard, or under the shard mutex, so the prepared response cannot be freed first.
+        static ResponseBody fromPrepared(PreparedResponse* prepared)
+        {
+            ResponseBody body;
+            prepared->refs.fetch_add(1, std::memory_order_relaxed);
+            body.m_prepared = prepared;
+            return body;
+        }
+
+        ResponseBody(ResponseBody&& other) noexcept : m_owned(std::move(other.m_owned)), m_node(other.m_node), m_prepared(other.m_prepared) 
+        { 
+            other.m_node = nullptr; 
+            other.m_prepared = nullptr;
+        }
+
+        ResponseBody& operator=(ResponseBody&& other) noexcept
+        {
+            if(this != &other) 
+            {
+                reset();
+                m_owned = std::move(other.m_owned);
+                m_node = other.m_node;
+                m_prepared = other.m_prepared;
+                other.m_node = nullptr;
+                other.m_prepared = nullptr;
+            }
+            return *this;
+        }
+
+        ResponseBody(const ResponseBody&) = delete;
+        ResponseBody& operator=(const ResponseBody&) = delete;
+
+        ~ResponseBody() { reset(); }
+
+        void reset()
+        {
+            if(m_node != nullptr) m_node->unpin();
+            if(m_prepared != nullptr) m_prepared->refs.fetch_sub(1, std::memory_order_release);
+            m_node = nullptr;
+            m_prepared = nullptr;
+            m_owned.clear();
+        }
+
+        bool inPlace() const { return m_node != nullptr || m_prepared != nullptr; }
+
+        // The whole keep-alive 200 response, when the body came with one; empty otherwise.
+        std::string_view prepared() const { return m_prepared != nullptr ? std::string_view(m_prepared->bytes) : std::string_view(); }
+
+        std::string_view view() const 
+        { 
+            if(m_prepared != nullptr) return m_prepared->body();
+            return m_node != nullptr ? m_node->value() : std::string_view(m_owned); 
+        }
+};
+
+// Under the shard mutex: the node's prepared response, built now if it can have one, else the node itself.
+ResponseBody hitBody(CacheShard& shard, Node* node)
+{
+    PreparedResponse* prepared = shard.prepared.build(node);
+    if(shard.prepared.retiredCount() >= CacheShard::RECLAIM_BATCH) shard.reclaim();
+    return prepared != nullptr ? ResponseBody::fromPrepared(prepared) : ResponseBody::fromNode(node);
+}
+
+// Serves a cache hit without the shard lock. Nodes are never modified after they are indexed (a set
+// swaps in a new node), so reading the value is safe while the EpochGuard keeps the node allocated;
+// take(node) copies or pins it before the guard is dropped. Returns false on anything the locked path has
+// to handle: a miss, an expired entry, or too many readers.
+template <typename Take>
+bool lookupLockFree(CacheShard& shard, std::string_view key, uint64_t hash, Take take)
+{
+    EpochGuard guard;
+    if(!guard.active()) return false;
+
+    Node* node = shard.store.find(key, hash);
+    if(node == nullptr || (node->hasExpiry() && node->isExpired(nowMs()))) return false;
+
+    take(node);
+    shard.lock_free_hits++;
+
+    if(shard.policy->onConcurrentHit(node)) return true;
+
+    size_t pos = shard.read_buffer_head.fetch_add(1, std::memory_order_relaxed) & (CacheShard::READ_BUFFER_SIZE - 1);
+    shard.read_buffer[pos].store(node, std::memory_order_release);
+    if(pos == CacheShard::READ_BUFFER_SIZE - 1) 
+    {
+        std::unique_lock<std::mutex> lock;
+        if(tryLockShard(shard, lock)) shard.drainReadBuffer();
+    }
+    return true;
+}
+
+// An expired entry leaves the cache like an eviction: a dirty value is written back first, so a TTL
+// bounds how long a value stays cached but never loses a write.
+void expireNode(CacheShard& shard, Node* node)
+{
+    queueWriteBack(node);
+    shard.policy->onRemove(node);
+    releaseNode(shard, node);
+}
+
+// Background reaper: advances every shard's timing wheel and drops the entries that came due. The same
+// tick reclaims retired nodes and replays buffered lock-free hits, so neither waits for the next write.
+void expiry_function(ShardedCache& cache)
+{
+    std::vector<TimerRef> due;
+    while(!g_shutdown_flag) 
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(TTL_REAPER_INTERVAL_MS));
+
+        for(size_t i = 0; i < cache.size(); i++) 
+        {
+            CacheShard& shard = cache.shard(i);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            uint64_t now = nowMs();
+            due.clear();
+            shard.wheel.advance(now, due);
+
+            for(const TimerRef& ref : due) 
+            {
+                if(!shard.store.contains(ref.node, ref.hash) || !ref.node->isExpired(now)) continue;
+                expireNode(shard, ref.node);
+                shard.expired_by_wheel++;
+            }
+            shard.reclaim();
+        }
+    }
+}
+
+std::string handle_set(std::string_view query, ShardedCache& cache, std::string& http_status)
+{
+    g_total_access++;
+
+    size_t keyPos = query.find("key=");
+    size_t valPos = query.find("value=");
+
+    if(keyPos == std::string::npos || valPos == std::string::npos) 
+    {
+        http_status = "400 Bad Request";
+        return "Error missing 'key' or 'value' parameter for /set.";
+    }
+
+    keyPos += 4;
+    valPos += 6;
+
+    size_t ttlPos = query.find("&ttl=");
+    uint64_t expire_at = 0;
+    if(ttlPos != std::string::npos) 
+    {
+        long ttl_ms = 0;
+        std::from_chars(query.data() + ttlPos + 5, query.data() + query.size(), ttl_ms);
+        if(ttl_ms <= 0) 
+        {
+            http_status = "400 Bad Request";
+            return "Error: 'ttl' must be a positive number of milliseconds.";
+        }
+        expire_at = nowMs() + ttl_ms;
+    }
+
+    std::string key = urlDecode(query.substr(keyPos, query.find("&", keyPos) - keyPos));
+    std::string value = urlDecode(query.substr(valPos, (ttlPos != std::string::npos && ttlPos > valPos) ? ttlPos - valPos : std::string::npos));
+
+    if(key.size() > MAX_KEY_LENGTH) 
+    {
+        http_status = "400 Bad Request";
+        return "Error: key longer than " + std::to_string(MAX_KEY_LENGTH) + " bytes.";
+    }
+
+    uint64_t hash = hashKey(key);
+    CacheShard& shard = cache.shardFor(hash);
+    shard.total_access++;
+    // Before the value becomes visible anywhere, so no get can find it in the cache but not in the filter.
+    g_key_filter.insert(hash);
+    WriteBackQueue::Reservation reservation(g_writeback);
+    std::unique_lock<std::mutex> lock = lockShard(shard);
+    shard.policy->recordAccess(hash);
+
+    // A miss being fetched right now would bring back the value this set replaces.
+    auto inflight = shard.inflight.find(key);
+    if(inflight != shard.inflight.end()) inflight->second->invalidated = true;
+    if(shard.negative.erase(hash)) shard.negative_invalidations++;
+
+    Node* foundNode = shard.store.find(key, hash);
+    size_t charge = shard.entryCharge(key.size(), value.size(), expire_at != 0);
+
+    if(foundNode != nullptr)
+    {
+        g_cache_hits++;
+        shard.cache_hits++;
+        std::cout << "[INFO] Cache Hit for Set. Updating Key: " << key << std::endl;
+
+        if(shard.bytes_used - shard.entryCharge(foundNode) + charge <= shard.capacity_bytes) 
+        {
+            foundNode = replaceNode(shard, foundNode, value, expire_at);
+            foundNode->setDirty(true);
+            shard.policy->onHit(foundNode);
+            return "OK: Key " + key + " was set (in cache and marked dirty)";
+        }
+
+        // The grown value no longer fits next to everything else: drop the stale copy and re-insert below.
+        shard.policy->onRemove(foundNode);
+        releaseNode(shard, foundNode);
+    }
+
+    //std::cout << "[INFO] Cache MISS for SET. Adding Key: " << key << std::endl;
+
+    if(!makeRoom(shard, charge, hash))
+    {
+        // Goes through the write-back queue too, so it cannot be overtaken by an older queued value of the key.
+        g_writeback.enqueue(key, value);
+        return "OK: Key " + key + " was set (too large for the cache, queued for the DB)";
+    }
+
+    insertNode(shard, key, value, hash, true, expire_at);
+
+    //std::cout << "[LOG] Set Key " << key << " to " << value << " (in cache and marked dirty)" << std::endl;
+    return "OK: Key " + key + " was set (in cache and marked dirty)";
+}
+
+// A /get or /delete that has to go to the backend, split around that request so an event loop can send it
+// with requestAsync() and come back for the rest (finishGet() or finishDelete()) once it is answered.
+struct BackendWait
+{
+    bool is_delete = false;
+    std::string key;
+    uint64_t hash = 0;
+    CacheShard* shard = nullptr;
+    // The fetch this get started, or a delete's tombstone. For WAITING, the fetch to wait for.
+    std::shared_ptr<InFlightFetch> fetch;
+    // A value that never reached the backend (dirty in the cache or queued for write-back) still counts
+    // as existing, so the backend's 404 for it is not an error.
+    bool unflushed = false;
+
+    BackendCall call() const { return BackendCall{is_delete ? OP_DELETE : OP_GET, key}; }
+};
+
+// How far a /get or /delete got without the backend: answered, in need of a backend request, or (for an
+// event loop, which must not wait) behind another request's fetch of the same key.
+enum class KeyStep { ANSWERED, BACKEND, WAITING };
+
+// The answer a miss gets from another request's fetch, once that is done without being invalidated.
+ResponseBody coalescedAnswer(CacheShard& shard, const InFlightFetch& fetch, const std::string& key, std::string& http_status)
+{
+    shard.coalesced_misses++;
+    if (fetch.status.rfind("200 OK", 0) == 0) 
+    {
+        return fetch.value;
+    }
+    http_status = fetch.status;
+    return "Error: Key : " + key + " Not Found.";
+}
+
+// Under the shard mutex: publishes the fetch's result to the threads and waiters on it and retires it.
+void completeFetch(CacheShard& shard, const std::string& key, const std::shared_ptr<InFlightFetch>& fetch)
+{
+    fetch->done = true;
+    auto it = shard.inflight.find(key);
+    if(it != shard.inflight.end() && it->second == fetch) shard.inflight.erase(it);
+    shard.fetch_cond.notify_all();
+    for(std::unique_ptr<FetchWaiter>& waiter : fetch->waiters) waiter.release()->fetched(*fetch);
+    fetch->waiters.clear();
+}
+
+// Hands waiter to wait.fetch, which owns it until it calls it. False, with the waiter still the caller's, if
+// the fetch is already done: the request should then begin again.
+bool joinFetch(BackendWait& wait, FetchWaiter* waiter)
+{
+    // The waiter may hold wait itself, and must not keep the fetch alive.
+    std::shared_ptr<InFlightFetch> fetch = std::move(wait.fetch);
+    std::unique_lock<std::mutex> lock = lockShard(*wait.shard);
+    if(fetch->done) return false;
+    fetch->waiters.emplace_back(waiter);
+    return true;
+}
+
+ResponseBody finishGet(BackendWait& wait, std::string backend_status, std::string value_from_db, std::string& http_status)
+{
+    CacheShard& shard = *wait.shard;
+    const std::string& key = wait.key;
+    uint64_t hash = wait.hash;
+    std::shared_ptr<InFlightFetch>& fetch = wait.fetch;
+
+    bool ok = backend_status.rfind("200 OK", 0) == 0;
+    WriteBackQueue::Reservation reservation(g_writeback, ok);
+
+    {
+        std::unique_lock<std::mutex> lock = lockShard(shard);
+        if(ok && !fetch->invalidated) 
+        {
+            std::cout << "[INFO] Found key in Backend DB. Inserting into Cache." << std::endl;
+
+            Node* existing = shard.store.find(key, hash);
+            if(existing != nullptr && existing->isExpired(nowMs())) 
+            {
+                expireNode(shard, existing);
+                existing = nullptr;
+            }
+            if(existing != nullptr) 
+            {
+                value_from_db.assign(existing->value()); 
+            }
+            else if(makeRoom(shard, shard.entryCharge(key.size(), value_from_db.size()), hash))
+            {
+                insertNode(shard, key, value_from_db, hash, false);
+            }
+        }
+        else if(backend_status.rfind("404", 0) == 0 && !fetch->invalidated) 
+        {
+            if(g_key_filter.ready()) 
+            {
+                if(g_key_filter.wasDeleted(hash)) g_key_filter.deleted_hits++;
+                else g_key_filter.false_positives++;
+            }
+            shard.negative.insert(hash, nowMs() + shard.negative_ttl_ms);
+        }
+
+        fetch->status = backend_status;
+        fetch->value = value_from_db;
+        completeFetch(shard, key, fetch);
+    }
+
+    if(ok) 
+    {
+        return value_from_db;
+    }
+    else
+    {
+        http_status = backend_status;
+        std::cout << "[LOG] Key " << key << " not found in Backend DB (" << backend_status << ")." << std::endl;
+        return "Error: Key : " + key + " Not Found.";
+    }
+}
+
+// A hit allocates nothing: the key is decoded into the request arena and looked up as a view, and the
+// body points into the cache. Only the locked and miss paths below build a std::string key. With block
+// a miss behind another request's fetch waits for it here; without, it returns WAITING.
+KeyStep beginGet(std::string_view query, ShardedCache& cache, std::string& http_status, ResponseBody& answer, BackendWait& wait, bool block)
+{
+    g_total_access++;
+    ResponseBody cached;
+    bool found = false;
+
+    size_t keyPos = query.find("key=");
+    if(keyPos == std::string::npos) 
+    {
+        http_status = "400 Bad Request";
+        answer = "Error missing 'key' parameter for /get.";
+        return KeyStep::ANSWERED;
+    }
+
+    keyPos += 4;
+    std::string_view key_view = urlDecode(query.substr(keyPos), t_request_arena);
+
+    if(key_view.size() > MAX_KEY_LENGTH) 
+    {
+        http_status = "400 Bad Request";
+        answer = "Error: key longer than " + std::to_string(MAX_KEY_LENGTH) + " bytes.";
+        return KeyStep::ANSWERED;
+    }
+
+    uint64_t hash = hashKey(key_view);
+    CacheShard& shard = cache.shardFor(hash);
+    shard.total_access++;
+
+    Node* unprepared = nullptr;
+    auto take = [&](Node* node) 
+    {
+        PreparedResponse* prepared = shard.prepared.find(node);
+        if(prepared != nullptr) cached = ResponseBody::fromPrepared(prepared);
+        else 
+        {
+            cached = ResponseBody::fromNode(node);
+            if(shard.prepared.wants(node)) unprepared = node;
+        }
+    };
+    if(lookupLockFree(shard, key_view, hash, take)) 
+    {
+        // First hit on this version of the entry: build its response if the lock is free, else next time.
+        if(unprepared != nullptr) 
+        {
+            std::unique_lock<std::mutex> lock;
+            if(tryLockShard(shard, lock) && shard.store.find(key_view, hash) == unprepared) cached = hitBody(shard, unprepared);
+        }
+        g_cache_hits++;
+        shard.cache_hits++;
+        std::cout << "[INFO] Found Key "  << key_view << " in Cache." << std::endl;
+        heavy_computation();
+        answer = std::move(cached);
+        return KeyStep::ANSWERED;
+    }
+    if(!g_key_filter.mayContain(hash)) 
+    {
+        g_key_filter.rejected++;
+        http_status = "404 Not Found";
+        answer = "Error: Key : " + std::string(key_view) + " Not Found.";
+        return KeyStep::ANSWERED;
+    }
+
+    wait.is_delete = false;
+    wait.key.assign(key_view);
+    wait.hash = hash;
+    wait.shard = &shard;
+    const std::string& key = wait.key;
+
+    std::shared_ptr<InFlightFetch> fetch;
+    bool recorded = false;
+    while(!found && fetch == nullptr)
+    {
+        std::unique_lock<std::mutex> lock = lockShard(shard);
+        if(!recorded) shard.policy->recordAccess(hash);
+        recorded = true;
+
+        Node* foundNode = shard.store.find(key, hash);
+        if(foundNode != nullptr && foundNode->isExpired(nowMs())) 
+        {
+            expireNode(shard, foundNode);
+            shard.expired_on_lookup++;
+            foundNode = nullptr;
+        }
+        if(foundNode != nullptr)
+        {
+            g_cache_hits++;
+            shard.cache_hits++;
+            std::cout << "[INFO] Found Key "  << key << " in Cache." << std::endl;
+            shard.policy->onHit(foundNode);
+
+            cached = hitBody(shard, foundNode);
+            found = true;
+            break;
+        }
+
+        if(shard.negative.contains(hash, nowMs())) 
+        {
+            shard.negative_hits++;
+            http_status = "404 Not Found";
+            answer = "Error: Key : " + key + " Not Found.";
+            return KeyStep::ANSWERED;
+        }
+
+        auto it = shard.inflight.find(key);
+        if(it == shard.inflight.end()) 
+        {
+            fetch = std::make_shared<InFlightFetch>();
+            shard.inflight.emplace(key, fetch);
+            break;
+        }
+
+        // Someone is already fetching this key: wait for that result instead of asking the backend again.
+        std::shared_ptr<InFlightFetch> other = it->second;
+        if(!block) 
+        {
+            wait.fetch = std::move(other);
+            return KeyStep::WAITING;
+        }
+        shard.fetch_cond.wait(lock, [&]() { return other->done; });
+        if(other->invalidated) continue;
+
+        answer = coalescedAnswer(shard, *other, key, http_status);
+        return KeyStep::ANSWERED;
+    }
+    if(found)
+    {
+        heavy_computation();
+        answer = std::move(cached);
+        return KeyStep::ANSWERED;
+    }
+
+    wait.fetch = std::move(fetch);
+    std::string value_from_db;
+    if(g_writeback.lookup(key, value_from_db)) 
+    {
+        std::cout << "[INFO] Cache MISS for GET. Key " << key << " is pending write-back, serving it from the queue." << std::endl;
+        answer = finishGet(wait, "200 OK", std::move(value_from_db), http_status);
+        return KeyStep::ANSWERED;
+    }
+    std::cout << "[INFO] Cache MISS for GET. Checking Backend Database for Key: " << key << std::endl;
+    return KeyStep::BACKEND;
+}
+
+ResponseBody handle_get(std::string_view query, ShardedCache& cache, std::string& http_status)
+{
+    ResponseBody answer;
+    BackendWait wait;
+    if(beginGet(query, cache, http_status, answer, wait, true) == KeyStep::ANSWERED) return answer;
+
+    std::string backend_status = "200 OK";
+    std::string value_from_db = sendToBackend(wait.call(), backend_status);
+    return finishGet(wait, std::move(backend_status), std::move(value_from_db), http_status);
+}
+
+KeyStep beginDelete(std::string_view query, ShardedCache& cache, std::string& http_status, ResponseBody& answer, BackendWait& wait)
+{
+    g_total_access++;
+
+    size_t keyPos = query.find("key=");
+    if(keyPos == std::string::npos) {
+        http_status = "400 Bad Request";
+        answer = "Error missing 'key' parameter for /delete.";
+        return KeyStep::ANSWERED;
+    }
+    keyPos += 4;
+    std::string key = urlDecode(query.substr(keyPos));
+
+    if(key.size() > MAX_KEY_LENGTH) 
+    {
+        http_status = "400 Bad Request";
+        answer = "Error: key longer than " + std::to_string(MAX_KEY_LENGTH) + " bytes.";
+        return KeyStep::ANSWERED;
+    }
+
+    uint64_t hash = hashKey(key);
+    CacheShard& shard = cache.shardFor(hash);
+    shard.total_access++;
+
+    // Until the backend has dropped the key, misses on it wait on this placeholder instead of fetching
+    // the old value and caching it again. A fetch already in flight is invalidated for the same reason.
+    std::shared_ptr<InFlightFetch> tombstone = std::make_shared<InFlightFetch>();
+    tombstone->invalidated = true;
+    bool unflushed = false;
+    {
+        std::unique_lock<std::mutex> lock = lockShard(shard);
+
+        auto it = shard.inflight.find(key);
+        if(it != shard.inflight.end()) it->second->invalidated = true;
+        shard.inflight[key] = tombstone;
+
+        Node* node_to_delete = shard.store.find(key, hash);
+        if(node_to_delete != nullptr)
+        {
+            g_cache_hits++;
+            shard.cache_hits++;
+            unflushed = node_to_delete->isDirty();
+            shard.policy->onRemove(node_to_delete);
+            releaseNode(shard, node_to_delete);
+            std::cout << "[LOG] Deleted Key " << key << " from in-Memory Cache." << std::endl;
+        }
+    }
+
+    if(g_writeback.cancel(key)) unflushed = true;
+
+    std::cout << "[INFO] Deleting Key " << key << " from Backend DB." << std::endl;
+    wait.is_delete = true;
+    wait.key = std::move(key);
+    wait.hash = hash;
+    wait.shard = &shard;
+    wait.fetch = std::move(tombstone);
+    wait.unflushed = unflushed;
+    return KeyStep::BACKEND;
+}
+
+std::string finishDelete(BackendWait& wait, const std::string& backend_status, const std::string& backend_response, std::string& http_status)
+{
+    {
+        std::unique_lock<std::mutex> lock = lockShard(*wait.shard);
+        completeFetch(*wait.shard, wait.key, wait.fetch);
+    }
+
+    if (backend_status.rfind("200 OK", 0) != 0 && !(wait.unflushed && backend_status.rfind("404", 0) == 0)) 
+    {
+        http_status = backend_status;
+        return "Error: Failed to delete key from Backend DB: " + backend_response;
+    }
+
+    g_key_filter.recordDelete(wait.hash);
+    return "Key: " + wait.key + " deleted (from cache and DB)";
+}
+
+ResponseBody handle_delete(std::string_view query, ShardedCache& cache, std::string& http_status)
+{
+    ResponseBody answer;
+    BackendWait wait;
+    if(beginDelete(query, cache, http_status, answer, wait) == KeyStep::ANSWERED) return answer;
+
+    std::string backend_status = "200 OK";
+    std::string backend_response = sendToBackend(wait.call(), backend_status);
+    return finishDelete(wait, backend_status, backend_response, http_status);
+}
+
+// For event loops, which must not block: begins a /get or /delete. ANSWERED leaves the answer in
+// http_status and answer. BACKEND leaves wait.call() to be sent with requestAsync(), whose answer goes to
+// finishKeyRequest(). WAITING means another request is fetching the key: joinFetch() its wait.fetch.
+KeyStep beginKeyRequest(std::string_view path, std::string_view query, ShardedCache& cache, std::string& http_status, ResponseBody& answer, BackendWait& wait)
+{
+    if(path == "delete") return beginDelete(query, cache, http_status, answer, wait);
+    return beginGet(query, cache, http_status, answer, wait, false);
+}
+
+ResponseBody finishKeyRequest(BackendWait& wait, std::string backend_status, std::string backend_body, std::string& http_status)
+{
+    if(wait.is_delete) return finishDelete(wait, backend_status, backend_body, http_status);
+    return finishGet(wait, std::move(backend_status), std::move(backend_body), http_status);
+}
+
+std::string describeEventLoop();
+
+std::string handle_stats(ShardedCache& cache)
+{
+    std::ostringstream out;
+    std::vector<SlabClassStats> classes;
+    size_t large_items = 0, large_bytes = 0;
+    size_t total_entries = 0, total_bytes = 0, total_capacity = 0;
+    size_t expired_on_lookup = 0, expired_by_wheel = 0, pending_timers = 0, coalesced_misses = 0;
+    size_t negative_hits = 0, negative_invalidations = 0, negative_entries = 0, negative_capacity = 0, negative_bytes = 0;
+    size_t prepared_entries = 0, prepared_capacity = 0, prepared_bytes = 0;
+    long prepared_builds = 0, prepared_displaced = 0, prepared_invalidated = 0;
+
+    out << "Eviction policy: " << cache.policyName() << "\n";
+
+    // Every shard is locked in turn below, this thread's own included.
+    OwnedShardRelease unowned;
+    for(size_t i = 0; i < cache.size(); i++) 
+    {
+        CacheShard& shard = cache.shard(i);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        out << "Shard " << i << ": " << shard.cache_hits << " hits / " << shard.total_access
+            << " accesses (" << shard.lock_free_hits << " hits lock-free), " << shard.count_of_pairs << " entries, " << shard.bytes_used << "/" << shard.capacity_bytes << " bytes";
+        std::string policy_state = shard.policy->describe();
+        if(!policy_state.empty()) out << " (" << policy_state << ")";
+        out << "\n";
+
+        classes.resize(shard.slab.numClasses());
+        for(size_t c = 0; c < shard.slab.numClasses(); c++) 
+        {
+            const SlabClassStats& st = shard.slab.classStats(c);
+            classes[c].chunk_size = st.chunk_size;
+            classes[c].pages += st.pages;
+            classes[c].total_chunks += st.total_chunks;
+            classes[c].used_chunks += st.used_chunks;
+            classes[c].requested_bytes += st.requested_bytes;
+        }
+        large_items += shard.slab.largeItems();
+        large_bytes += shard.slab.largeBytes();
+        total_entries += shard.count_of_pairs;
+        total_bytes += shard.bytes_used;
+        total_capacity += shard.capacity_bytes;
+        expired_on_lookup += shard.expired_on_lookup;
+        coalesced_misses += shard.coalesced_misses;
+        negative_hits += shard.negative_hits;
+        negative_invalidations += shard.negative_invalidations;
+        negative_entries += shard.negative.size();
+        negative_capacity += shard.negative.capacity();
+        negative_bytes += shard.negative.memoryBytes();
+        prepared_entries += shard.prepared.size();
+        prepared_capacity += shard.prepared.capacity();
+        prepared_bytes += shard.prepared.memoryBytes();
+        prepared_builds += shard.prepared.builds;
+        prepared_displaced += shard.prepared.displaced;
+        prepared_invalidated += shard.prepared.invalidated;
+        expired_by_wheel += shard.expired_by_wheel;
+        pending_timers += shard.wheel.pending();
+    }
+
+    out << "Cache memory: " << total_bytes << "/" << total_capacity << " bytes, " << total_entries << " entries, "
+        << (total_entries > 0 ? total_bytes / total_entries : 0) << " bytes/entry average\n";
+    out << "Misses coalesced onto an in-flight backend fetch: " << coalesced_misses << "\n";
+    out << "Negative cache: " << negative_hits << " hits (not counted as cache hits above), " << negative_entries << "/" << negative_capacity
+        << " entries (" << negative_bytes << " bytes), " << negative_invalidations << " invalidated by set, ttl " << cache.shard(0).negative_ttl_ms << " ms\n";
+    // Each send of a prepared response skips rendering its Content-Length and gathering three header fragments.
+    out << "Prepared responses: " << prepared_entries << "/" << prepared_capacity << " entries, " << prepared_bytes << " bytes (values up to "
+        << PREPARED_MAX_VALUE << " bytes), " << prepared_builds << " built, " << prepared_displaced << " displaced by another key, "
+        << prepared_invalidated << " invalidated, " << g_prepared_sends << " sent ("
+        << (prepared_builds > 0 ? (double)g_prepared_sends / prepared_builds : 0.0) << " sends per build)\n";
+    out << "TTL: " << expired_on_lookup << " expired on lookup, " << expired_by_wheel << " reaped by timing wheel, "
+        << pending_timers << " timers pending\n";
+    out << g_key_filter.describe();
+    out << g_backend_pool.describe();
+    out << g_writeback.describe();
+    out << describeEventLoop();
+
+    for(size_t c = 0; c < classes.size(); c++) 
+    {
+        const SlabClassStats& st = classes[c];
+        if(st.pages == 0) continue;
+
+        double utilization = 0.0;
+        if(st.used_chunks > 0) 
+        {
+            utilization = (double)st.requested_bytes / (st.used_chunks * st.chunk_size) * 100.0;
+        }
+        out << "Slab class " << c << " (" << st.chunk_size << " B): " << st.pages << " pages, "
+            << st.used_chunks << "/" << st.total_chunks << " chunks used, "
+            << utilization << "% of used chunk bytes requested\n";
+    }
+    out << "Large items (malloc): " << large_items << " items, " << large_bytes << " bytes\n";
+    return out.str();
+}
+
+void flushAllToDB(ShardedCache& cache)
+{
+    std::cout << "[INFO] Flushing all dirty nodes to Backend DB during shutdown..." << std::endl;
+    int count = 0;
+    auto flush_start = std::chrono::steady_clock::now();
+
+    for(size_t i = 0; i < cache.size(); i++)
+    {
+        CacheShard& shard = cache.shard(i);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        shard.policy->forEach([&](Node* current)
+        {
+            if (current->isDirty())
+            {
+                queueWriteBack(current);
+                count++;
+            }
+        });
+    }
+    g_writeback.drain();
+    double flush_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - flush_start).count();
+    std::cout << "[INFO] Flushed " << count << " dirty nodes to Backend in " << flush_ms << " ms." << std::endl;
+    if(g_writeback.dropped() > 0) std::cerr << "[ERROR] " << g_writeback.dropped() << " dirty keys never reached the backend; see the errors above." << std::endl;
+}
+
+void signal_handler(int signum) 
+{
+    std::cout << "\n[INFO] SIGINT (Ctrl+C) received. Initiating shutdown..." << std::endl;
+    g_shutdown_flag = 1;
+
+
+    if(g_server_fd != -1)
+    {
+        close(g_server_fd);
+        g_server_fd = -1;
+    }
+}
+
+void handle_client(int new_socket, ShardedCache& cache);
+
+void worker_function(ThreadSafeQueue<int>& queue, ShardedCache& cache) 
+{
+    std::thread::id thread_id = std::this_thread::get_id();
+    std::cout << "[INFO] Worker Thread " << thread_id  <<" starting." << std::endl;;
+
+    while(true) 
+    {
+        int new_socket;
+        if(!queue.pop(new_socket)) 
+        {
+            std::cout << "[INFO] Worker thread " << thread_id << " exiting." << std::endl;
+            break;
+        }
+        std::cout << "[INFO] Worker thread " << thread_id << " handling a new client." << std::endl;
+        handle_client(new_socket, cache);
+    }
+}
+
+// A request parsed in place: every view points into the connection's ConnectionBuffer and is valid until
+// the request is consumed.
+struct HttpRequest
+{
+    std::string_view method;
+    std::string_view path;
+    std::string_view query;
+    std::string_view body;
+    bool keep_alive = true;
+};
+
+enum class ParseResult { INCOMPLETE, COMPLETE, BAD, TOO_LARGE };
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    if(a.size() != b.size()) return false;
+    for(size_t i = 0; i < a.size(); i++) 
+    {
+        if(tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+// Incremental HTTP/1.x request parser. It allocates nothing, and a request that arrives over several
+// reads is not searched again from the start each time: m_scanned remembers how far the search for the
+// end of the headers got. Bodies are framed by Content-Length; chunked bodies are rejected.
+class HttpRequestParser
+{
+    private:
+        size_t m_scanned = 0;
+
+    public:
+        void reset() { m_scanned = 0; }
+
+        // On COMPLETE, fills req and sets consumed to the length of the request including its body.
+        ParseResult parse(const char* data, size_t len, HttpRequest& req, size_t& consumed)
+        {
+            std::string_view in(data, len);
+            size_t skip = 0;
+            while(skip < in.size() && (in[skip] == '\r' || in[skip] == '\n')) skip++;
+
+            size_t header_end = in.find("\r\n\r\n", std::max(m_scanned, skip + 3) - 3);
+            if(header_end == std::string_view::npos) 
+            {
+                m_scanned = in.size();
+                return in.size() > MAX_REQUEST_SIZE ? ParseResult::TOO_LARGE : ParseResult::INCOMPLETE;
+            }
+            m_scanned = header_end;
+
+            std::string_view head = in.substr(skip, header_end + 2 - skip);
+            size_t line_end = head.find("\r\n");
+            std::string_view request_line = head.substr(0, line_end);
+            size_t sp1 = request_line.find(' ');
+            size_t sp2 = sp1 == std::string_view::npos ? sp1 : request_line.find(' ', sp1 + 1);
+            if(sp2 == std::string_view::npos) return ParseResult::BAD;
+
+            req = HttpRequest();
+            req.method = request_line.substr(0, sp1);
+            std::string_view target = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+            std::string_view version = request_line.substr(sp2 + 1);
+            if(target.empty() || target[0] != '/' || version.compare(0, 7, "HTTP/1.") != 0) return ParseResult::BAD;
+            req.keep_alive = version != "HTTP/1.0";
+
+            size_t query_pos = target.find('?');
+            req.path = target.substr(1, query_pos == std::string_view::npos ? std::string_view::npos : query_pos - 1);
+            if(query_pos != std::string_view::npos) req.query = target.substr(query_pos + 1);
+
+            size_t content_length = 0;
+            size_t pos = line_end + 2;
+            while(pos < head.size()) 
+            {
+                size_t end = head.find("\r\n", pos);
+                std::string_view line = head.substr(pos, end - pos);
+                pos = end + 2;
+
+                size_t colon = line.find(':');
+                if(colon == std::string_view::npos) return ParseResult::BAD;
+                std::string_view name = line.substr(0, colon);
+                std::string_view value = line.substr(colon + 1);
+                while(!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+                while(!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+
+                if(equalsIgnoreCase(name, "Content-Length")) 
+                {
+                    if(value.empty() || value.size() > 9) return ParseResult::BAD;
+                    content_length = 0;
+                    for(char c : value) 
+                    {
+                        if(c < '0' || c > '9') return ParseResult::BAD;
+                        content_length = content_length * 10 + (c - '0');
+                    }
+                }
+                else if(equalsIgnoreCase(name, "Connection")) 
+                {
+                    if(equalsIgnoreCase(value, "close")) req.keep_alive = false;
+                    else if(equalsIgnoreCase(value, "keep-alive")) req.keep_alive = true;
+                }
+                else if(equalsIgnoreCase(name, "Transfer-Encoding")) 
+                {
+                    return ParseResult::BAD;
+                }
+            }
+
+            size_t total = header_end + 4 + content_length;
+            if(total > MAX_REQUEST_SIZE) return ParseResult::TOO_LARGE;
+            if(in.size() < total) return ParseResult::INCOMPLETE;
+
+            req.body = in.substr(header_end + 4, content_length);
+            consumed = total;
+            return ParseResult::COMPLETE;
+        }
+};
+
+// Per-connection receive buffer. Requests are parsed where they were read; the unparsed tail is moved
+// to the front only when a read would not fit behind it, and the buffer grows only for requests larger
+// than BUFFER_SIZE, so a connection does not allocate or copy per request.
+class ConnectionBuffer
+{
+    private:
+        std::vector<char> m_data;
+        size_t m_begin = 0;
+        size_t m_end = 0;
+
+    public:
+        ConnectionBuffer() : m_data(BUFFER_SIZE) {}
+
+        const char* data() const { return m_data.data() + m_begin; }
+        size_t size() const { return m_end - m_begin; }
+
+        void consume(size_t n)
+        {
+            m_begin += n;
+            if(m_begin == m_end) m_begin = m_end = 0;
+        }
+
+        // Makes room for the next read and returns where it goes.
+        char* prepare(size_t& room)
+        {
+            if(m_data.size() - m_end < BUFFER_SIZE / 2 && m_begin > 0) 
+            {
+                memmove(m_data.data(), m_data.data() + m_begin, m_end - m_begin);
+                m_end -= m_begin;
+                m_begin = 0;
+            }
+            if(m_data.size() - m_end < BUFFER_SIZE / 2) m_data.resize(m_data.size() * 2);
+            room = m_data.size() - m_end;
+            return m_data.data() + m_end;
+        }
+
+        void commit(size_t n) { m_end += n; }
+};
+
+// Responses to pipelined requests, answered in request order and written together with one writev
+// once no further complete request is buffered. A 200 response is sent as the fixed header fragments
+// below, its length digits and the body in place, so only the digits are written per response.
+class ResponseBatch
+{
+    private:
+        static constexpr std::string_view OK_HEAD = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: ";
+        static constexpr std::string_view KEEP_ALIVE_TAIL = "\r\nConnection: keep-alive\r\n\r\n";
+        static constexpr std::string_view CLOSE_TAIL = "\r\nConnection: close\r\n\r\n";
+
+        struct Response
+        {
+            std::string head;  // Only rendered for statuses other than 200 OK.
+            bool whole = false; // The body carries the complete response.
+            char length[24];
+            size_t length_size = 0;
+            bool keep_alive = true;
+            ResponseBody body;
+        };
+
+        std::vector<Response> m_responses;
+        std::vector<struct iovec> m_iov;
+        struct msghdr m_msg = {};
+        size_t m_first = 0;
+        size_t m_count = 0;
+        size_t m_unfilled = 0;
+
+        static struct iovec fragment(std::string_view bytes) { return {(void*)bytes.data(), bytes.size()}; }
+
+        void buildIov()
+        {
+            m_iov.clear();
+            for(size_t i = 0; i < m_count; i++) 
+            {
+                const Response& response = m_responses[i];
+                if(response.whole) 
+                {
+                    m_iov.push_back(fragment(response.body.prepared()));
+                    continue;
+                }
+                m_iov.push_back(fragment(response.head.empty() ? OK_HEAD : std::string_view(response.head)));
+                m_iov.push_back({(void*)response.length, response.length_size});
+                m_iov.push_back(fragment(response.keep_alive ? KEEP_ALIVE_TAIL : CLOSE_TAIL));
+                std::string_view body = response.body.view();
+                if(!body.empty()) m_iov.push_back(fragment(body));
+            }
+            m_first = 0;
+        }
+
+        // Drops the bodies of a batch that has gone out, unpinning the cache entries they pointed into.
+        void release()
+        {
+            for(size_t i = 0; i < m_count; i++) m_responses[i].body.reset();
+            m_iov.clear();
+            m_first = 0;
+            m_count = 0;
+        }
+
+    public:
+        size_t count() const { return m_count; }
+
+        // True while part of the batch is written and the rest is not; add() must wait until it is all out.
+        bool pending() const { return m_first < m_iov.size(); }
+
+        // False while a reserved response is still being answered elsewhere; the batch cannot be sent until then.
+        bool ready() const { return m_unfilled == 0; }
+
+        // Holds the place of a response answered later, so the ones after it can be added in request order.
+        size_t reserve()
+        {
+            if(m_count == m_responses.size()) m_responses.emplace_back();
+            m_unfilled++;
+            return m_count++;
+        }
+
+        void fill(size_t slot, const std::string& http_status, ResponseBody&& body, bool keep_alive)
+        {
+            Response& response = m_responses[slot];
+            response.head.clear();
+            response.whole = keep_alive && !body.prepared().empty() && http_status == "200 OK";
+            if(response.whole) 
+            {
+                response.body = std::move(body);
+                g_prepared_sends++;
+                g_zero_copy_responses++;
+                m_unfilled--;
+                return;
+            }
+            if(http_status != "200 OK") 
+            {
+                response.head += "HTTP/1.1 ";
+                response.head += http_status;
+                response.head += "\r\nContent-Type: text/plain\r\nContent-Length: ";
+            }
+            response.body = std::move(body);
+            std::string_view bytes = response.body.view();
+            response.length_size = std::to_chars(response.length, response.length + sizeof(response.length), bytes.size()).ptr - response.length;
+            response.keep_alive = keep_alive;
+
+            if(response.body.inPlace()) g_zero_copy_responses++;
+            g_response_bytes_copied += response.head.size() + response.length_size + (response.body.inPlace() ? 0 : bytes.size());
+            m_unfilled--;
+        }
+
+        void add(const std::string& http_status, ResponseBody&& body, bool keep_alive)
+        {
+            fill(reserve(), http_status, std::move(body), keep_alive);
+        }
+
+        bool flush(int fd)
+        {
+            if(m_count == 0) return true;
+            buildIov();
+            bool sent = sendAll(fd, m_iov.data(), m_iov.size(), &g_client_syscalls);
+            release();
+            return sent;
+        }
+
+        // For asynchronous senders: the part of the batch not yet sent, valid until sent() is called.
+        struct msghdr* unsent()
+        {
+            if(!pending()) buildIov();
+            m_msg = {};
+            m_msg.msg_iov = m_iov.data() + m_first;
+            m_msg.msg_iovlen = std::min<size_t>(m_iov.size() - m_first, IOV_MAX);
+            return &m_msg;
+        }
+
+        // Records that n more bytes went out; true once the whole batch has, which empties it.
+        bool sent(size_t n)
+        {
+            while(m_first < m_iov.size() && n >= m_iov[m_first].iov_len) 
+            {
+                n -= m_iov[m_first].iov_len;
+                m_first++;
+            }
+            if(m_first < m_iov.size()) 
+            {
+                m_iov[m_first].iov_base = (char*)m_iov[m_first].iov_base + n;
+                m_iov[m_first].iov_len -= n;
+                return false;
+            }
+            release();
+            return true;
+        }
+
+        enum FlushResult { DONE, AGAIN, FAILED };
+
+        // For non-blocking sockets: writes what the socket takes now and keeps the rest for the next call.
+        FlushResult flushNonBlocking(int fd)
+        {
+            while(m_count > 0) 
+            {
+                g_client_syscalls++;
+                ssize_t n = sendmsg(fd, unsent(), MSG_NOSIGNAL | MSG_DONTWAIT);
+                if(n < 0 && errno == EINTR) continue;
+                if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return AGAIN;
+                if(n <= 0) return FAILED;
+                sent(n);
+            }
+            return DONE;
+        }
+};
+
+ResponseBody dispatchRequest(const HttpRequest& request, ShardedCache& cache, std::string& http_status, bool& keep_alive)
+{
+    if(request.method != "GET" && request.method != "POST") 
+    {
+        http_status = "400 Bad Request";
+        return "Error: Malformed Request";
+    }
+
+    // A POST carries its parameters form-encoded in the body.
+    std::string_view query = request.query.empty() && request.method == "POST" ? request.body : request.query;
+    std::string_view path = request.path;
+
+    if (path == "set")
+        return handle_set(query, cache, http_status);
+    if (path == "get")
+        return handle_get(query, cache, http_status);
+    if (path == "delete")
+        return handle_delete(query, cache, http_status);
+    if (path == "stats")
+        return handle_stats(cache);
+    if (path == "disconnect") 
+    {
+        keep_alive = false;
+        return "OK Disconnecting. ";
+    }
+
+    http_status = "400 Bad Request";
+    return "Usage: /set, /get, /delete, /stats, /disconnect\n";
+}
+
+// Lets a serving mode answer some requests elsewhere. forward() returns true if it took the request, after
+// reserving its place in responses; the batch goes out once that place is filled.
+class RequestForwarder
+{
+    public:
+        virtual ~RequestForwarder() {}
+        virtual bool forward(const HttpRequest& request, ResponseBatch& responses) = 0;
+};
+
+// Answers the complete requests at the front of input, in order, up to MAX_PIPELINED_RESPONSES of them
+// (counting those the forwarder takes). Returns false when the connection must close once those responses
+// are sent: the client asked to, or sent a request the stream cannot be resynchronized after.
+bool answerRequests(ConnectionBuffer& input, HttpRequestParser& parser, ResponseBatch& responses, ShardedCache& cache, RequestForwarder* forwarder = nullptr)
+{
+    while (responses.count() < MAX_PIPELINED_RESPONSES)
+    {
+        HttpRequest request;
+        size_t consumed = 0;
+        ParseResult result = parser.parse(input.data(), input.size(), request, consumed);
+        if (result == ParseResult::INCOMPLETE) return true;
+
+        if (result != ParseResult::COMPLETE)
+        {
+            if (result == ParseResult::TOO_LARGE) responses.add("413 Payload Too Large", "Error: Request too large", false);
+            else responses.add("400 Bad Request", "Error: Malformed Request", false);
+            return false;
+        }
+
+        g_client_requests++;
+        if (forwarder != nullptr && forwarder->forward(request, responses))
+        {
+            t_request_arena.reset();
+            input.consume(consumed);
+            parser.reset();
+            if (!request.keep_alive) return false;
+            continue;
+        }
+
+        std::string http_status = "200 OK";
+        bool keep_alive = request.keep_alive;
+        ResponseBody response_body = dispatchRequest(request, cache, http_status, keep_alive);
+        responses.add(http_status, std::move(response_body), keep_alive);
+        t_request_arena.reset();
+        input.consume(consumed);
+        parser.reset();
+        if (!keep_alive) return false;
+    }
+    return true;
+}
+
+// Clients may pipeline: every complete request in the buffer is answered, in order, before the next
+// read, and a request split across reads waits in the buffer for the rest of it.
+void handle_client(int new_socket, ShardedCache& cache)
+{
+
+    add_socket(new_socket);
+    char client_ip[INET_ADDRSTRLEN];
+    struct sockaddr_in client_address;
+    socklen_t client_addrlen = sizeof(client_address);
+
+    getpeername(new_socket, (sockaddr*)&client_address, &client_addrlen);
+
+    inet_ntop(AF_INET, &client_address.sin_addr, client_ip, INET_ADDRSTRLEN);
+    int client_port = ntohs(client_address.sin_port);
+
+    std::cout << "[INFO] Thread " << std::this_thread::get_id() <<" handling client from " <<client_ip << ":" <<client_port<< std::endl;
+
+    ConnectionBuffer input;
+    HttpRequestParser parser;
+    ResponseBatch responses;
+
+    while (true)
+    {
+        bool keep_open = answerRequests(input, parser, responses, cache);
+        size_t answered = responses.count();
+        if (!responses.flush(new_socket) || !keep_open) break;
+        if (answered == MAX_PIPELINED_RESPONSES) continue;
+
+        size_t room = 0;
+        char* read_to = input.prepare(room);
+        g_client_syscalls++;
+        int bytes_read = read(new_socket, read_to, room);
+        if (bytes_read <= 0) break;
+        input.commit(bytes_read);
+    }
+
+    remove_socket(new_socket);
+    close(new_socket);
+    std::cout << "[INFO] Thread " << std::this_thread::get_id() << " finished. Closing Connection." << std::endl;
+}
+
+enum class ReadResult { DRAINED, FULL, CLOSED };
+
+// Reads a non-blocking socket until it would block, the peer is gone, or a request is too large to keep
+// buffering (FULL: the socket may still hold data).
+ReadResult readAvailable(int fd, ConnectionBuffer& input)
+{
+    while (input.size() <= MAX_REQUEST_SIZE)
+    {
+        size_t room = 0;
+        char* read_to = input.prepare(room);
+        g_client_syscalls++;
+        ssize_t bytes_read = read(fd, read_to, room);
+        if (bytes_read > 0) 
+        {
+            input.commit(bytes_read);
+            continue;
+        }
+        if (bytes_read < 0 && errno == EINTR) continue;
+        if (bytes_read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) return ReadResult::CLOSED;
+        return ReadResult::DRAINED;
+    }
+    return ReadResult::FULL;
+}
+
+struct ClientConnection
+{
+    int fd;
+    int epoll_fd;
+    ConnectionBuffer input;
+    HttpRequestParser parser;
+    ResponseBatch responses;
+    // Answer what is already buffered, then close: the peer is gone or asked to close.
+    bool closing = false;
+    // Stored before the connection is (re-)armed and loaded by the thread that gets its event. The
+    // epoll syscalls already order the handoff; this makes it visible to the memory model and to TSan.
+    std::atomic<uint32_t> handoffs{0};
+};
+
+// Event-driven serving (--event-loop): a few I/O threads multiplex every client connection with
+// edge-triggered epoll and hand requests to a pool of workers, so the number of open connections is no
+// longer bounded by the number of threads. Connections are armed EPOLLONESHOT, which makes exactly one
+// thread the owner of a connection at any time:
+//  - the I/O thread that gets its event reads until EAGAIN, and passes the connection to a worker once
+//    a whole request is buffered, or re-arms it for more input;
+//  - the worker answers every complete request, writes what the socket takes without blocking and
+//    re-arms it, for writing if output is left over. The I/O thread finishes that write when the client
+//    catches up, so a slow client never holds a thread.
+class EventLoop
+{
+    private:
+        ShardedCache& m_cache;
+        std::vector<int> m_epoll_fds;
+        int m_wake_fd = -1;
+        std::vector<std::thread> m_io_threads;
+        std::vector<std::thread> m_workers;
+        ThreadSafeQueue<ClientConnection*> m_ready;
+        std::atomic<bool> m_stop{false};
+        std::atomic<size_t> m_next{0};
+
+        std::mutex m_mutex;
+        std::unordered_set<ClientConnection*> m_conns;
+        long m_accepted = 0;
+        size_t m_peak_open = 0;
+        std::atomic<long> m_dispatches{0};
+        std::atomic<long> m_write_waits{0};
+
+        // The connection belongs to another thread the moment it is re-armed, so nothing in it is touched after.
+        static void arm(ClientConnection* conn, uint32_t events)
+        {
+            int epoll_fd = conn->epoll_fd, fd = conn->fd;
+            struct epoll_event ev = {};
+            ev.events = events | EPOLLET | EPOLLONESHOT | EPOLLRDHUP;
+            ev.data.ptr = conn;
+            conn->handoffs.fetch_add(1, std::memory_order_release);
+            g_client_syscalls++;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+        }
+
+        void closeConnection(ClientConnection* conn)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_conns.erase(conn);
+            }
+            remove_socket(conn->fd);
+            close(conn->fd);
+            delete conn;
+        }
+
+        void onEvent(ClientConnection* conn)
+        {
+            conn->handoffs.load(std::memory_order_acquire);
+            if (conn->responses.pending())
+            {
+                ResponseBatch::FlushResult flushed = conn->responses.flushNonBlocking(conn->fd);
+                if (flushed == ResponseBatch::AGAIN) 
+                {
+                    arm(conn, EPOLLOUT);
+                    return;
+                }
+                if (flushed == ResponseBatch::FAILED) 
+                {
+                    closeConnection(conn);
+                    return;
+                }
+            }
+
+            if (!conn->closing && readAvailable(conn->fd, conn->input) == ReadResult::CLOSED) conn->closing = true;
+
+            HttpRequest request;
+            size_t consumed = 0;
+            if (conn->input.size() > 0 && conn->parser.parse(conn->input.data(), conn->input.size(), request, consumed) != ParseResult::INCOMPLETE)
+            {
+                m_dispatches++;
+                m_ready.push(conn);
+            }
+            else if (conn->closing)
+            {
+                closeConnection(conn);
+            }
+            else
+            {
+                arm(conn, EPOLLIN);
+            }
+        }
+
+        void ioLoop(size_t index)
+        {
+            struct epoll_event events[256];
+            while (!m_stop)
+            {
+                int n = epoll_wait(m_epoll_fds[index], events, 256, -1);
+                g_client_syscalls++;
+                if (n < 0 && errno != EINTR)
+                {
+                    perror("epoll_wait failed");
+                    break;
+                }
+                for (int i = 0; i < n; i++)
+                {
+                    // A null pointer is the wakeup eventfd, written only by stop().
+                    if (events[i].data.ptr != nullptr) onEvent(static_cast<ClientConnection*>(events[i].data.ptr));
+                }
+            }
+        }
+
+        void serve(ClientConnection* conn)
+        {
+            while (true)
+            {
+                // Whatever follows a bad request or a close is not answered, even if the final flush has to wait.
+                if (!answerRequests(conn->input, conn->parser, conn->responses, m_cache))
+                {
+                    conn->closing = true;
+                    conn->input.consume(conn->input.size());
+                }
+                size_t answered = conn->responses.count();
+
+                ResponseBatch::FlushResult flushed = conn->responses.flushNonBlocking(conn->fd);
+                if (flushed == ResponseBatch::AGAIN)
+                {
+                    m_write_waits++;
+                    arm(conn, EPOLLOUT);
+                    return;
+                }
+                if (flushed == ResponseBatch::FAILED || conn->closing)
+                {
+                    closeConnection(conn);
+                    return;
+                }
+                if (answered < MAX_PIPELINED_RESPONSES) break;
+            }
+            // Input that arrived while the worker held the connection is reported as soon as it is re-armed.
+            arm(conn, EPOLLIN);
+        }
+
+        void workerLoop()
+        {
+            ClientConnection* conn;
+            while (m_ready.pop(conn)) serve(conn);
+        }
+
+    public:
+        explicit EventLoop(ShardedCache& cache) : m_cache(cache) {}
+
+        ~EventLoop()
+        {
+            for (ClientConnection* conn : m_conns) delete conn;
+            for (int fd : m_epoll_fds) close(fd);
+            if (m_wake_fd != -1) close(m_wake_fd);
+        }
+
+        bool start(size_t io_threads, size_t workers)
+        {
+            m_wake_fd = eventfd(0, EFD_NONBLOCK);
+            if (m_wake_fd < 0)
+            {
+                perror("eventfd failed");
+                return false;
+            }
+            for (size_t i = 0; i < std::max<size_t>(1, io_threads); i++)
+            {
+                int epoll_fd = epoll_create1(0);
+                struct epoll_event ev = {};
+                ev.events = EPOLLIN;
+                ev.data.ptr = nullptr;
+                if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &ev) < 0)
+                {
+                    perror("epoll setup failed");
+                    return false;
+                }
+                m_epoll_fds.push_back(epoll_fd);
+            }
+            for (size_t i = 0; i < m_epoll_fds.size(); i++) m_io_threads.emplace_back(&EventLoop::ioLoop, this, i);
+            for (size_t i = 0; i < std::max<size_t>(1, workers); i++) m_workers.emplace_back(&EventLoop::workerLoop, this);
+            return true;
+        }
+
+        // Takes over a freshly accepted socket; connections are spread round-robin over the I/O threads.
+        void add(int fd)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            ClientConnection* conn = new ClientConnection();
+            conn->fd = fd;
+            conn->epoll_fd = m_epoll_fds[m_next++ % m_epoll_fds.size()];
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_conns.insert(conn);
+                m_accepted++;
+                m_peak_open = std::max(m_peak_open, m_conns.size());
+            }
+            add_socket(fd);
+
+            int epoll_fd = conn->epoll_fd;
+            struct epoll_event ev = {};
+            ev.events = EPOLLIN | EPOLLET | EPOLLONESHOT | EPOLLRDHUP;
+            ev.data.ptr = conn;
+            conn->handoffs.fetch_add(1, std::memory_order_release);
+            g_client_syscalls++;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            {
+                // Never registered, so still ours.
+                perror("epoll_ctl ADD failed");
+                closeConnection(conn);
+            }
+        }
+
+        // Stops the I/O threads, then lets the workers finish what was already handed to them. Connections
+        // still open are left open (and registered via add_socket) for the caller to say goodbye on.
+        void stop()
+        {
+            m_stop = true;
+            uint64_t one = 1;
+            if (write(m_wake_fd, &one, sizeof(one)) < 0) perror("eventfd write failed");
+            for (std::thread& t : m_io_threads) t.join();
+            m_ready.stop();
+            for (std::thread& t : m_workers) t.join();
+        }
+
+        std::string describe()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::ostringstream out;
+            out << "Event loop: " << m_epoll_fds.size() << " I/O threads, " << m_workers.size() << " workers, " << m_conns.size() << " connections open (peak "
+                << m_peak_open << ", " << m_accepted << " accepted), " << m_dispatches << " dispatches, " << m_write_waits << " writes waiting on slow clients\n";
+            return out.str();
+        }
+};
+
+// Minimal io_uring wrapper over the raw syscalls: one submission and one completion ring, shared with the
+// kernel through mmap. Only the thread that owns it may call sqe(), submit() and drain().
+class IoUring
+{
+    private:
+        int m_fd = -1;
+        void* m_rings = MAP_FAILED;
+        size_t m_rings_size = 0;
+        struct io_uring_sqe* m_sqes = (struct io_uring_sqe*)MAP_FAILED;
+        size_t m_sqes_size = 0;
+
+        unsigned* m_sq_head = nullptr;
+        unsigned* m_sq_tail = nullptr;
+        unsigned* m_sq_array = nullptr;
+        unsigned m_sq_mask = 0;
+        unsigned m_sq_entries = 0;
+        unsigned m_sq_local_tail = 0;
+        unsigned m_to_submit = 0;
+
+        unsigned* m_cq_head = nullptr;
+        unsigned* m_cq_tail = nullptr;
+        unsigned m_cq_mask = 0;
+        struct io_uring_cqe* m_cqes = nullptr;
+
+    public:
+        std::atomic<long> enters{0};
+        std::atomic<long> completions{0};
+
+        IoUring() = default;
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+
+        ~IoUring() { destroy(); }
+
+        // Closing the ring cancels every operation still in flight on it.
+        void destroy()
+        {
+            if (m_sqes != MAP_FAILED) munmap(m_sqes, m_sqes_size);
+            if (m_rings != MAP_FAILED) munmap(m_rings, m_rings_size);
+            if (m_fd != -1) close(m_fd);
+            m_sqes = (struct io_uring_sqe*)MAP_FAILED;
+            m_rings = MAP_FAILED;
+            m_fd = -1;
+        }
+
+        int fd() const { return m_fd; }
+
+        // Returns 0, or the errno of the step that failed. The completion ring is sized on its own: a multishot
+        // request whose completion finds it full is terminated and must be re-armed, so it needs room for a
+        // completion from every busy connection.
+        int init(unsigned entries, unsigned cq_entries)
+        {
+            struct io_uring_params params = {};
+            params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+            params.cq_entries = cq_entries;
+            m_fd = syscall(__NR_io_uring_setup, entries, &params);
+            if (m_fd < 0 && errno == EINVAL) 
+            {
+                // COOP_TASKRUN (5.19) only saves interrupts; run without it on kernels that reject it.
+                params = {};
+                params.flags = IORING_SETUP_CQSIZE;
+                params.cq_entries = cq_entries;
+                m_fd = syscall(__NR_io_uring_setup, entries, &params);
+            }
+            if (m_fd < 0) return errno;
+            if (!(params.features & IORING_FEAT_SINGLE_MMAP)) return ENOSYS;
+
+            m_rings_size = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                            params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+            m_rings = mmap(nullptr, m_rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+            if (m_rings == MAP_FAILED) return errno;
+            m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+            m_sqes = (struct io_uring_sqe*)mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+            if (m_sqes == MAP_FAILED) return errno;
+
+            char* base = (char*)m_rings;
+            m_sq_head = (unsigned*)(base + params.sq_off.head);
+            m_sq_tail = (unsigned*)(base + params.sq_off.tail);
+            m_sq_array = (unsigned*)(base + params.sq_off.array);
+            m_sq_mask = *(unsigned*)(base + params.sq_off.ring_mask);
+            m_sq_entries = params.sq_entries;
+            m_sq_local_tail = *m_sq_tail;
+            m_cq_head = (unsigned*)(base + params.cq_off.head);
+            m_cq_tail = (unsigned*)(base + params.cq_off.tail);
+            m_cq_mask = *(unsigned*)(base + params.cq_off.ring_mask);
+            m_cqes = (struct io_uring_cqe*)(base + params.cq_off.cqes);
+            return 0;
+        }
+
+        int registerOp(unsigned opcode, void* arg, unsigned nr_args)
+        {
+            return syscall(__NR_io_uring_register, m_fd, opcode, arg, nr_args) < 0 ? errno : 0;
+        }
+
+        // A zeroed submission entry. It is only queued here; submit() hands everything queued so far to the
+        // kernel in one syscall, unless the ring fills up first.
+        struct io_uring_sqe* sqe()
+        {
+            if (m_sq_local_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) >= m_sq_entries) submit(0);
+            unsigned index = m_sq_local_tail & m_sq_mask;
+            struct io_uring_sqe* entry = &m_sqes[index];
+            memset(entry, 0, sizeof(*entry));
+            m_sq_array[index] = index;
+            m_sq_local_tail++;
+            m_to_submit++;
+            return entry;
+        }
+
+        // Submits the queued entries and, if wait_nr > 0, waits for that many completions.
+        void submit(unsigned wait_nr)
+        {
+            __atomic_store_n(m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE);
+            enters++;
+            g_client_syscalls++;
+            int submitted = syscall(__NR_io_uring_enter, m_fd, m_to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (submitted > 0) m_to_submit -= std::min<unsigned>(m_to_submit, submitted);
+        }
+
+        template <typename F>
+        void drain(F handle)
+        {
+            unsigned head = *m_cq_head;
+            unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++)
+            {
+                completions++;
+                handle(m_cqes[head & m_cq_mask]);
+            }
+            __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+        }
+};
+
+// A ring of receive buffers registered with the kernel (IORING_REGISTER_PBUF_RING): a multishot recv picks
+// the next free buffer itself when data arrives, so idle connections pin no buffer memory, and the
+// buffer is handed back by publishing it on the ring again.
+class ProvidedBuffers
+{
+    private:
+        struct io_uring_buf_ring* m_ring = (struct io_uring_buf_ring*)MAP_FAILED;
+        size_t m_ring_size = 0;
+        char* m_memory = (char*)MAP_FAILED;
+        uint16_t m_tail = 0;
+
+        void publish(uint16_t bid)
+        {
+            // Indexed by hand: compiled as C++, the header's flexible bufs[] lands 8 bytes past the ring start.
+            struct io_uring_buf* buf = (struct io_uring_buf*)m_ring + (m_tail & (URING_BUFFERS - 1));
+            buf->addr = (uint64_t)(uintptr_t)buffer(bid);
+            buf->len = URING_BUFFER_SIZE;
+            buf->bid = bid;
+            m_tail++;
+        }
+
+    public:
+        ProvidedBuffers() = default;
+        ProvidedBuffers(const ProvidedBuffers&) = delete;
+        ProvidedBuffers& operator=(const ProvidedBuffers&) = delete;
+
+        ~ProvidedBuffers()
+        {
+            if (m_memory != MAP_FAILED) munmap(m_memory, (size_t)URING_BUFFERS * URING_BUFFER_SIZE);
+            if (m_ring != MAP_FAILED) munmap(m_ring, m_ring_size);
+        }
+
+        // Returns 0, or the errno of the step that failed (EINVAL from the register call: kernel older than 5.19).
+        int init(IoUring& uring)
+        {
+            m_ring_size = URING_BUFFERS * sizeof(struct io_uring_buf);
+            m_ring = (struct io_uring_buf_ring*)mmap(nullptr, m_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (m_ring == MAP_FAILED) return errno;
+            m_memory = (char*)mmap(nullptr, (size_t)URING_BUFFERS * URING_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (m_memory == MAP_FAILED) return errno;
+
+            for (uint16_t bid = 0; bid < URING_BUFFERS; bid++) publish(bid);
+            __atomic_store_n(&m_ring->tail, m_tail, __ATOMIC_RELEASE);
+
+            struct io_uring_buf_reg reg = {};
+            reg.ring_addr = (uint64_t)(uintptr_t)m_ring;
+            reg.ring_entries = URING_BUFFERS;
+            reg.bgid = URING_BUFFER_GROUP;
+            return uring.registerOp(IORING_REGISTER_PBUF_RING, &reg, 1);
+        }
+
+        char* buffer(uint16_t bid) { return m_memory + (size_t)bid * URING_BUFFER_SIZE; }
+
+        void recycle(uint16_t bid)
+        {
+            publish(bid);
+            __atomic_store_n(&m_ring->tail, m_tail, __ATOMIC_RELEASE);
+        }
+};
+
+// Messages for one event-loop thread from any thread, without a lock: a post pushes onto a linked list
+// with one compare-and-swap, and the loop takes the whole list with one exchange. Only a post onto an
+// empty list needs to wake the loop; the rest ride along with that wakeup.
+template <typename Message>
+class MessageInbox
+{
+    private:
+        std::atomic<Message*> m_head{nullptr};
+
+    public:
+        ~MessageInbox()
+        {
+            Message* message = take();
+            while (message != nullptr) 
+            {
+                Message* next = message->next;
+                delete message;
+                message = next;
+            }
+        }
+
+        // True if the inbox was empty, so the loop has to be woken.
+        bool push(Message* message)
+        {
+            Message* head = m_head.load(std::memory_order_relaxed);
+            do 
+            {
+                message->next = head;
+            } while (!m_head.compare_exchange_weak(head, message, std::memory_order_release, std::memory_order_relaxed));
+            return head == nullptr;
+        }
+
+        // Everything posted so far, oldest first, linked through next.
+        Message* take()
+        {
+            Message* head = m_head.exchange(nullptr, std::memory_order_acquire);
+            Message* ordered = nullptr;
+            while (head != nullptr) 
+            {
+                Message* next = head->next;
+                head->next = ordered;
+                ordered = head;
+                head = next;
+            }
+            return ordered;
+        }
+};
+
+class IoUringEngine;
+
+struct RingConnection : public RequestForwarder
+{
+    int fd;
+    IoUringEngine* engine;
+    size_t ring;
+    ConnectionBuffer input;
+    HttpRequestParser parser;
+    // A /get or /delete waiting on the backend holds a reserved place here until its reply is in.
+    ResponseBatch responses;
+    // A multishot recv is armed; it stays armed across completions flagged IORING_CQE_F_MORE.
+    bool receiving = false;
+    // A sendmsg of responses is in flight; only one at a time, so responses go out in order.
+    bool sending = false;
+    // The recv was cancelled because input piled up behind a send the client is not reading.
+    bool cancelling = false;
+    // The recv ended with every provided buffer in use; it is re-armed after the current pass over the
+    // completions has handed buffers back.
+    bool starved = false;
+    // Answer what is already buffered, then close: the peer is gone or asked to close.
+    bool closing = false;
+    bool shut_down = false;
+
+    bool forward(const HttpRequest& request, ResponseBatch& batch) override;
+};
+
+// A /get or /delete a ring answers later, coming back to the ring through its inbox: BEGIN to (re)start it,
+// FETCHED with the backend's answer, or REPLY with the answer another request's fetch gave it.
+struct RingMessage : public FetchWaiter
+{
+    enum Kind { BEGIN, FETCHED, REPLY };
+
+    RingMessage* next = nullptr;
+    Kind kind = BEGIN;
+    RingConnection* conn;
+    size_t slot;
+    bool keep_alive;
+    std::string path;
+    std::string query;
+    BackendWait wait;
+    std::string status;
+    std::string value;
+    ResponseBody body;
+
+    void fetched(const InFlightFetch& fetch) override;
+};
+
+// io_uring serving (--io-uring): each ring thread owns a ring with a multishot accept on the listening
+// socket, a multishot recv per connection drawing from a ring of provided buffers, and at most one
+// sendmsg in flight per connection. Everything a pass over the completions queues is submitted by the one
+// io_uring_enter that also waits for the next completions, so a busy ring costs roughly one syscall per
+// batch of events instead of a read, a write and an epoll_ctl per request.
+//
+// Requests are answered on the ring thread, except that a /get miss or a /delete does not wait there for
+// the backend: it goes out with requestAsync(), keeps its place in the connection's batch, and its answer
+// comes back through the ring's inbox, which the ring drains when the read on its wake eventfd completes.
+class IoUringEngine
+{
+    private:
+        enum Tag : uint64_t { TAG_ACCEPT = 1, TAG_RECV = 2, TAG_SEND = 3, TAG_WAKE = 4, TAG_CANCEL = 5, TAG_MASK = 7 };
+
+        struct Ring
+        {
+            size_t index = 0;
+            IoUring uring;
+            ProvidedBuffers buffers;
+            int wake_fd = -1;
+            uint64_t wake_value = 0;
+            MessageInbox<RingMessage> inbox;
+            std::unordered_set<RingConnection*> conns;
+            std::vector<RingConnection*> starved;
+
+            ~Ring()
+            {
+                uring.destroy();
+                for (RingConnection* conn : conns) delete conn;
+                if (wake_fd != -1) close(wake_fd);
+            }
+        };
+
+        ShardedCache& m_cache;
+        std::vector<std::unique_ptr<Ring>> m_rings;
+        std::vector<std::thread> m_threads;
+        std::atomic<bool> m_stop{false};
+        std::atomic<long> m_accepted{0};
+        std::atomic<long> m_open{0};
+        std::atomic<long> m_partial_sends{0};
+        std::atomic<long> m_recv_rearms{0};
+        std::atomic<long> m_starved{0};
+        std::atomic<long> m_backend_waits{0};
+        std::atomic<long> m_joined{0};
+
+        static uint64_t userData(void* ptr, Tag tag) { return (uint64_t)(uintptr_t)ptr | tag; }
+
+        void submitAccept(Ring& ring)
+        {
+            struct io_uring_sqe* sqe = ring.uring.sqe();
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->fd = g_server_fd;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->user_data = userData(nullptr, TAG_ACCEPT);
+        }
+
+        void submitWake(Ring& ring)
+        {
+            struct io_uring_sqe* sqe = ring.uring.sqe();
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = ring.wake_fd;
+            sqe->addr = (uint64_t)(uintptr_t)&ring.wake_value;
+            sqe->len = sizeof(ring.wake_value);
+            sqe->user_data = userData(nullptr, TAG_WAKE);
+        }
+
+        void submitRecv(Ring& ring, RingConnection* conn)
+        {
+            struct io_uring_sqe* sqe = ring.uring.sqe();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = conn->fd;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = URING_BUFFER_GROUP;
+            sqe->user_data = userData(conn, TAG_RECV);
+            conn->receiving = true;
+        }
+
+        void submitSend(Ring& ring, RingConnection* conn)
+        {
+            struct io_uring_sqe* sqe = ring.uring.sqe();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = conn->fd;
+            sqe->addr = (uint64_t)(uintptr_t)conn->responses.unsent();
+            sqe->msg_flags = MSG_NOSIGNAL;
+            sqe->user_data = userData(conn, TAG_SEND);
+            conn->sending = true;
+        }
+
+        void cancelRecv(Ring& ring, RingConnection* conn)
+        {
+            struct io_uring_sqe* sqe = ring.uring.sqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = userData(conn, TAG_RECV);
+            sqe->user_data = userData(nullptr, TAG_CANCEL);
+            conn->cancelling = true;
+        }
+
+        // Frees the connection once the kernel holds no operation on it; shutting the socket down ends its recv.
+        // A reply still on its way calls process() again, which comes back here once it is sent.
+        void finish(Ring& ring, RingConnection* conn)
+        {
+            if (!conn->responses.ready()) return;
+            if (conn->receiving && !conn->shut_down) 
+            {
+                shutdown(conn->fd, SHUT_RDWR);
+                conn->shut_down = true;
+            }
+            if (conn->receiving || conn->sending || conn->starved) return;
+            ring.conns.erase(conn);
+            m_open--;
+            remove_socket(conn->fd);
+            close(conn->fd);
+            delete conn;
+        }
+
+        // Answers what is buffered and decides the connection's next operation. Nothing moves while a reply
+        // is outstanding; its arrival calls this again.
+        void process(Ring& ring, RingConnection* conn)
+        {
+            if (conn->sending || !conn->responses.ready()) return;
+            if (!answerRequests(conn->input, conn->parser, conn->responses, m_cache, conn)) 
+            {
+                conn->closing = true;
+                conn->input.consume(conn->input.size());
+            }
+            if (!conn->responses.ready()) return;
+            if (conn->responses.count() > 0) submitSend(ring, conn);
+            else if (conn->closing) finish(ring, conn);
+            else if (!conn->receiving && !conn->starved) 
+            {
+                m_recv_rearms++;
+                submitRecv(ring, conn);
+            }
+        }
+
+        void onAccept(Ring& ring, const struct io_uring_cqe& cqe)
+        {
+            if (!(cqe.flags & IORING_CQE_F_MORE) && !m_stop) submitAccept(ring);
+            if (cqe.res < 0) 
+            {
+                if (cqe.res != -ECANCELED) std::cerr << "[WARN] io_uring accept failed: " << strerror(-cqe.res) << std::endl;
+                return;
+            }
+            RingConnection* conn = new RingConnection();
+            conn->fd = cqe.res;
+            conn->engine = this;
+            conn->ring = ring.index;
+            ring.conns.insert(conn);
+            m_accepted++;
+            m_open++;
+            add_socket(conn->fd);
+            submitRecv(ring, conn);
+        }
+
+        void onRecv(Ring& ring, RingConnection* conn, const struct io_uring_cqe& cqe)
+        {
+            if (!(cqe.flags & IORING_CQE_F_MORE)) 
+            {
+                conn->receiving = false;
+                conn->cancelling = false;
+            }
+            if (cqe.res > 0) 
+            {
+                uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                // Past closing nothing more is answered, so late input is dropped.
+                if (!conn->closing) 
+                {
+                    const char* data = ring.buffers.buffer(bid);
+                    size_t left = cqe.res;
+                    while (left > 0) 
+                    {
+                        size_t room = 0;
+                        char* to = conn->input.prepare(room);
+                        size_t n = std::min(room, left);
+                        memcpy(to, data, n);
+                        conn->input.commit(n);
+                        data += n;
+                        left -= n;
+                    }
+                }
+                ring.buffers.recycle(bid);
+                // A client that pipelines without reading its responses, or while one is awaited, is stopped at the
+                // request size limit.
+                if ((conn->sending || !conn->responses.ready()) && conn->receiving && !conn->cancelling && conn->input.size() > MAX_REQUEST_SIZE) cancelRecv(ring, conn);
+            }
+            else if (cqe.res == -ENOBUFS && !conn->receiving && !conn->closing) 
+            {
+                // Re-arming now would only fail again, once per readable connection.
+                m_starved++;
+                conn->starved = true;
+                ring.starved.push_back(conn);
+                return;
+            }
+            else if (cqe.res == 0 || (cqe.res != -ENOBUFS && cqe.res != -ECANCELED)) 
+            {
+                conn->closing = true;
+            }
+            if (conn->closing && !conn->sending && conn->input.size() == 0) finish(ring, conn);
+            else process(ring, conn);
+        }
+
+        void onSend(Ring& ring, RingConnection* conn, const struct io_uring_cqe& cqe)
+        {
+            conn->sending = false;
+            if (cqe.res <= 0) 
+            {
+                conn->closing = true;
+                conn->input.consume(conn->input.size());
+                conn->responses.sent(SIZE_MAX);
+                finish(ring, conn);
+                return;
+            }
+            if (!conn->responses.sent(cqe.res)) 
+            {
+                m_partial_sends++;
+                submitSend(ring, conn);
+                return;
+            }
+            process(ring, conn);
+        }
+
+        // Sends message's request to the backend, or parks it on the fetch it found in flight. False if that
+        // fetch finished meanwhile and the request has to begin again.
+        bool park(RingMessage* message, KeyStep step)
+        {
+            if (step == KeyStep::BACKEND) 
+            {
+                m_backend_waits++;
+                g_backend_pool.requestAsync(message->wait.call(), [this, message](std::string http_status, std::string body) 
+                {
+                    message->kind = RingMessage::FETCHED;
+                    message->status = std::move(http_status);
+                    message->value = std::move(body);
+                    post(message);
+                });
+                return true;
+            }
+            m_joined++;
+            message->kind = RingMessage::BEGIN;
+            return joinFetch(message->wait, message);
+        }
+
+        void onMessage(Ring& ring, RingMessage* message)
+        {
+            std::string http_status = "200 OK";
+            ResponseBody body;
+            switch (message->kind) 
+            {
+                case RingMessage::BEGIN: 
+                {
+                    KeyStep step = beginKeyRequest(message->path, message->query, m_cache, http_status, body, message->wait);
+                    if (step != KeyStep::ANSWERED) 
+                    {
+                        if (!park(message, step)) post(message);
+                        return;
+                    }
+                    break;
+                }
+                case RingMessage::FETCHED: 
+                    body = finishKeyRequest(message->wait, std::move(message->status), std::move(message->value), http_status);
+                    break;
+                case RingMessage::REPLY: 
+                    http_status = std::move(message->status);
+                    body = std::move(message->body);
+                    break;
+            }
+            RingConnection* conn = message->conn;
+            conn->responses.fill(message->slot, http_status, std::move(body), message->keep_alive);
+            delete message;
+            process(ring, conn);
+        }
+
+        void onWake(Ring& ring)
+        {
+            if (!m_stop) submitWake(ring);
+            RingMessage* message = ring.inbox.take();
+            while (message != nullptr) 
+            {
+                RingMessage* next = message->next;
+                onMessage(ring, message);
+                t_request_arena.reset();
+                message = next;
+            }
+        }
+
+        void ringLoop(Ring& ring)
+        {
+            while (!m_stop)
+            {
+                ring.uring.submit(1);
+                ring.uring.drain([&](const struct io_uring_cqe& cqe) {
+                    void* ptr = (void*)(uintptr_t)(cqe.user_data & ~(uint64_t)TAG_MASK);
+                    switch (cqe.user_data & TAG_MASK) 
+                    {
+                        case TAG_ACCEPT: onAccept(ring, cqe); break;
+                        case TAG_RECV: onRecv(ring, static_cast<RingConnection*>(ptr), cqe); break;
+                        case TAG_SEND: onSend(ring, static_cast<RingConnection*>(ptr), cqe); break;
+                        case TAG_WAKE: onWake(ring); break;
+                        default: break;
+                    }
+                });
+                for (RingConnection* conn : ring.starved) 
+                {
+                    conn->starved = false;
+                    if (conn->closing) finish(ring, conn);
+                    else process(ring, conn);
+                }
+                ring.starved.clear();
+            }
+        }
+
+    public:
+        explicit IoUringEngine(ShardedCache& cache) : m_cache(cache) {}
+
+        // Hands a message to the ring its connection belongs to, from any thread.
+        void post(RingMessage* message)
+        {
+            Ring& ring = *m_rings[message->conn->ring];
+            if (!ring.inbox.push(message)) return;
+            uint64_t one = 1;
+            if (write(ring.wake_fd, &one, sizeof(one)) < 0) perror("eventfd write failed");
+        }
+
+        // Takes a /get or /delete, answering it now if the backend is not needed.
+        bool forward(RingConnection* conn, const HttpRequest& request, ResponseBatch& responses)
+        {
+            std::string_view path = request.path;
+            if (path != "get" && path != "delete") return false;
+            std::string_view query = request.query.empty() && request.method == "POST" ? request.body : request.query;
+
+            std::string http_status = "200 OK";
+            ResponseBody body;
+            BackendWait wait;
+            KeyStep step = beginKeyRequest(path, query, m_cache, http_status, body, wait);
+            if (step == KeyStep::ANSWERED) 
+            {
+                responses.add(http_status, std::move(body), request.keep_alive);
+                return true;
+            }
+
+            RingMessage* message = new RingMessage();
+            message->conn = conn;
+            message->slot = responses.reserve();
+            message->keep_alive = request.keep_alive;
+            message->path = std::string(path);
+            message->query = std::string(query);
+            message->wait = std::move(wait);
+            if (!park(message, step)) post(message);
+            return true;
+        }
+
+        // Sets up the rings and starts one thread per ring. Returns false, with the reason, when this kernel
+        // cannot run the engine; nothing has been started then and the caller can fall back to epoll.
+        bool start(size_t rings, std::string& reason)
+        {
+            struct utsname uts;
+            int major = 0, minor = 0;
+            if (uname(&uts) == 0) sscanf(uts.release, "%d.%d", &major, &minor);
+            if (major < 6) 
+            {
+                // Multishot recv needs 6.0; the provided buffer ring and multishot accept need 5.19.
+                reason = std::string("kernel ") + uts.release + " is older than 6.0";
+                return false;
+            }
+            for (size_t i = 0; i < std::max<size_t>(1, rings); i++)
+            {
+                std::unique_ptr<Ring> ring(new Ring());
+                ring->index = m_rings.size();
+                int err = ring->uring.init(URING_ENTRIES, URING_CQ_ENTRIES);
+                if (err != 0) 
+                {
+                    reason = std::string("io_uring_setup: ") + strerror(err);
+                    return false;
+                }
+                err = ring->buffers.init(ring->uring);
+                if (err != 0) 
+                {
+                    reason = std::string("provided buffer ring: ") + strerror(err);
+                    return false;
+                }
+                ring->wake_fd = eventfd(0, 0);
+                if (ring->wake_fd < 0) 
+                {
+                    reason = std::string("eventfd: ") + strerror(errno);
+                    return false;
+                }
+                submitAccept(*ring);
+                submitWake(*ring);
+                m_rings.push_back(std::move(ring));
+            }
+            for (std::unique_ptr<Ring>& ring : m_rings) m_threads.emplace_back(&IoUringEngine::ringLoop, this, std::ref(*ring));
+            return true;
+        }
+
+        // Stops the ring threads. Connections still open are left open (and registered via add_socket) for
+        // the caller to say goodbye on.
+        void stop()
+        {
+            m_stop = true;
+            uint64_t one = 1;
+            for (std::unique_ptr<Ring>& ring : m_rings) 
+            {
+                if (write(ring->wake_fd, &one, sizeof(one)) < 0) perror("eventfd write failed");
+            }
+            for (std::thread& t : m_threads) t.join();
+        }
+
+        std::string describe()
+        {
+            long enters = 0, completions = 0;
+            for (std::unique_ptr<Ring>& ring : m_rings) 
+            {
+                enters += ring->uring.enters;
+                completions += ring->uring.completions;
+            }
+            std::ostringstream out;
+            out << "io_uring: " << m_rings.size() << " rings, " << m_open << " connections open (" << m_accepted << " accepted), " << enters << " io_uring_enter calls, "
+                << (enters > 0 ? (double)completions / enters : 0.0) << " completions per call, " << m_partial_sends << " partial sends, " << m_recv_rearms << " recvs re-armed (" << m_starved << " after running out of buffers), "
+                << m_backend_waits << " backend requests and " << m_joined << " waits on another request's fetch answered without holding the ring\n";
+            return out.str();
+        }
+};
+
+bool RingConnection::forward(const HttpRequest& request, ResponseBatch& batch)
+{
+    return engine->forward(this, request, batch);
+}
+
+void RingMessage::fetched(const InFlightFetch& fetch)
+{
+    if (fetch.invalidated) kind = BEGIN;
+    else 
+    {
+        kind = REPLY;
+        status = "200 OK";
+        body = coalescedAnswer(*wait.shard, fetch, wait.key, status);
+    }
+    conn->engine->post(this);
+}
+
+class PerCoreServer;
+
+struct CoreConnection : public RequestForwarder
+{
+    int fd;
+    size_t core;
+    PerCoreServer* server;
+    ConnectionBuffer input;
+    HttpRequestParser parser;
+    // Requests forwarded to the core that owns their key, or waiting on the backend, hold reserved places
+    // here until the reply is in.
+    ResponseBatch responses;
+    // The last read stopped at the request size limit rather than draining the socket.
+    bool unread = false;
+    // Registered for EPOLLOUT because a client is not reading fast enough.
+    bool writing = false;
+    // The peer is gone: answer what is already buffered, then close.
+    bool closing = false;
+    // Close once the responses so far are sent: the client asked to, or the stream cannot be resynchronized.
+    bool done = false;
+
+    bool forward(const HttpRequest& request, ResponseBatch& batch) override;
+};
+
+// A request travelling to the core that owns its key (REQUEST), back to it with the backend's answer
+// (FETCHED), and its response travelling back to the connection's core (REPLY).
+struct CoreMessage : public FetchWaiter
+{
+    enum Kind { REQUEST, FETCHED, REPLY };
+
+    CoreMessage* next = nullptr;
+    Kind kind = REQUEST;
+    CoreConnection* conn;
+    size_t owner;
+    size_t slot;
+    bool keep_alive;
+    std::string path;
+    std::string query;
+    BackendWait wait;
+    std::string status;
+    std::string value;
+    ResponseBody body;
+
+    void fetched(const InFlightFetch& fetch) override;
+};
+
+// Shared-nothing serving (--reuseport): one thread per core, each pinned to its CPU with its own
+// SO_REUSEPORT listener on FRONTEND_PORT, its own epoll loop and its own cache shard. The kernel spreads
+// connections over the listeners, so no queue or lock is shared on the accept path. A core answers
+// requests for keys in its own shard inline and forwards the rest to the owning core over that core's
+// inbox (a lock-free list plus an eventfd wakeup); the reply comes back the same way and is written by
+// the core that owns the connection, in request order.
+//
+// Only its core touches a shard's entries, so a core takes its shard's mutex once per batch of events
+// instead of once per request; the handlers skip it (t_owned_shard), and the background threads
+// (expiry, key filter rebuild) get it between batches. A /get miss or a /delete does not hold the core:
+// it goes to the backend with requestAsync() and is finished when the answer comes back as a message.
+class PerCoreServer
+{
+    private:
+        struct Core
+        {
+            size_t index = 0;
+            int listen_fd = -1;
+            int epoll_fd = -1;
+            int wake_fd = -1;
+            std::thread thread;
+            std::unordered_set<CoreConnection*> conns;
+            MessageInbox<CoreMessage> inbox;
+
+            std::atomic<long> accepted{0};
+            std::atomic<long> open{0};
+            std::atomic<long> forwarded_out{0};
+            std::atomic<long> answered_for_others{0};
+            std::atomic<long> backend_waits{0};
+            std::atomic<long> joined{0};
+            std::atomic<long> wakeups{0};
+            std::atomic<long> messages{0};
+
+            ~Core()
+            {
+                for (CoreConnection* conn : conns) delete conn;
+                if (listen_fd != -1) close(listen_fd);
+                if (epoll_fd != -1) close(epoll_fd);
+                if (wake_fd != -1) close(wake_fd);
+            }
+        };
+
+        ShardedCache& m_cache;
+        std::vector<std::unique_ptr<Core>> m_cores;
+        std::atomic<bool> m_stop{false};
+
+        // Sends message's request to the backend, or parks it on the fetch it found in flight. False if that
+        // fetch finished meanwhile and the request has to begin again.
+        bool park(Core& core, CoreMessage* message, KeyStep step)
+        {
+            if (step == KeyStep::BACKEND) 
+            {
+                core.backend_waits++;
+                g_backend_pool.requestAsync(message->wait.call(), [this, message](std::string http_status, std::string body) 
+                {
+                    message->kind = CoreMessage::FETCHED;
+                    message->status = std::move(http_status);
+                    message->value = std::move(body);
+                    post(message->owner, message);
+                });
+                return true;
+            }
+            core.joined++;
+            message->kind = CoreMessage::REQUEST;
+            return joinFetch(message->wait, message);
+        }
+
+        // Fills the message's place in its connection's batch, here or on the core the connection belongs to.
+        void answer(Core& core, CoreMessage* message, std::string&& http_status, ResponseBody&& body, bool keep_alive)
+        {
+            if (message->conn->core != core.index) 
+            {
+                core.answered_for_others++;
+                message->kind = CoreMessage::REPLY;
+                message->status = std::move(http_status);
+                message->body = std::move(body);
+                message->keep_alive = keep_alive;
+                post(message->conn->core, message);
+                return;
+            }
+            CoreConnection* conn = message->conn;
+            conn->responses.fill(message->slot, http_status, std::move(body), keep_alive);
+            delete message;
+            if (conn->responses.ready()) serve(core, conn);
+        }
+
+        void onMessage(Core& core, CoreMessage* message)
+        {
+            std::string http_status = "200 OK";
+            ResponseBody body;
+            bool keep_alive = message->keep_alive;
+            switch (message->kind) 
+            {
+                case CoreMessage::REQUEST: 
+                {
+                    if (message->path == "set") 
+                    {
+                        HttpRequest request;
+                        request.method = "GET";
+                        request.path = message->path;
+                        request.query = message->query;
+                        request.keep_alive = message->keep_alive;
+                        body = dispatchRequest(request, m_cache, http_status, keep_alive);
+                        break;
+                    }
+                    KeyStep step = beginKeyRequest(message->path, message->query, m_cache, http_status, body, message->wait);
+                    if (step != KeyStep::ANSWERED) 
+                    {
+                        if (!park(core, message, step)) post(core.index, message);
+                        return;
+                    }
+                    break;
+                }
+                case CoreMessage::FETCHED: 
+                    body = finishKeyRequest(message->wait, std::move(message->status), std::move(message->value), http_status);
+                    break;
+                case CoreMessage::REPLY: 
+                    http_status = std::move(message->status);
+                    body = std::move(message->body);
+                    break;
+            }
+            answer(core, message, std::move(http_status), std::move(body), keep_alive);
+        }
+
+        void drainInbox(Core& core)
+        {
+            uint64_t count;
+            g_client_syscalls++;
+            if (read(core.wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) perror("eventfd read failed");
+
+            core.wakeups++;
+            CoreMessage* message = core.inbox.take();
+            while (message != nullptr) 
+            {
+                CoreMessage* next = message->next;
+                core.messages++;
+                onMessage(core, message);
+                t_request_arena.reset();
+                message = next;
+            }
+        }
+
+        void watchWrites(Core& core, CoreConnection* conn, bool writing)
+        {
+            if (conn->writing == writing) return;
+            conn->writing = writing;
+            struct epoll_event ev = {};
+            ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (writing ? (uint32_t)EPOLLOUT : 0u);
+            ev.data.ptr = conn;
+            g_client_syscalls++;
+            epoll_ctl(core.epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+        }
+
+        // Only once no forwarded request is outstanding: the owning core still holds a pointer until it replies.
+        void drop(Core& core, CoreConnection* conn)
+        {
+            core.conns.erase(conn);
+            core.open--;
+            remove_socket(conn->fd);
+            close(conn->fd);
+            delete conn;
+        }
+
+        void acceptAll(Core& core)
+        {
+            while (true)
+            {
+                g_client_syscalls++;
+                int fd = accept4(core.listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+                if (fd < 0) 
+                {
+                    if (errno == EINTR) continue;
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) perror("Connection Accept Failed");
+                    return;
+                }
+                // Responses leave as whole batches, so Nagle only adds delay: a batch written before the client
+                // has ACKed the previous one would wait for its delayed ACK.
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                CoreConnection* conn = new CoreConnection();
+                conn->fd = fd;
+                conn->core = core.index;
+                conn->server = this;
+                core.conns.insert(conn);
+                core.accepted++;
+                core.open++;
+                add_socket(fd);
+
+                struct epoll_event ev = {};
+                ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+                ev.data.ptr = conn;
+                g_client_syscalls++;
+                if (epoll_ctl(core.epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) 
+                {
+                    perror("epoll_ctl ADD failed");
+                    drop(core, conn);
+                    continue;
+                }
+                conn->unread = true;
+                serve(core, conn);
+            }
+        }
+
+        // Moves the connection as far as it can go without blocking: sends the batch once every forwarded
+        // request in it is answered, reads, answers, and closes it once there is nothing left to do.
+        void serve(Core& core, CoreConnection* conn)
+        {
+            while (true)
+            {
+                if (conn->responses.pending() || (conn->responses.count() > 0 && conn->responses.ready()))
+                {
+                    ResponseBatch::FlushResult flushed = conn->responses.flushNonBlocking(conn->fd);
+                    if (flushed == ResponseBatch::AGAIN) 
+                    {
+                        watchWrites(core, conn, true);
+                        return;
+                    }
+                    if (flushed == ResponseBatch::FAILED) 
+                    {
+                        drop(core, conn);
+                        return;
+                    }
+                    watchWrites(core, conn, false);
+                }
+                if (!conn->responses.ready()) return;
+                if (conn->done) 
+                {
+                    drop(core, conn);
+                    return;
+                }
+
+                if (conn->unread && !conn->closing) 
+                {
+                    ReadResult result = readAvailable(conn->fd, conn->input);
+                    conn->unread = result == ReadResult::FULL;
+                    if (result == ReadResult::CLOSED) conn->closing = true;
+                }
+                if (!answerRequests(conn->input, conn->parser, conn->responses, m_cache, conn)) conn->done = true;
+                if (conn->responses.count() > 0 || conn->done) continue;
+
+                // Nothing complete is buffered.
+                if (conn->closing) drop(core, conn);
+                return;
+            }
+        }
+
+        void coreLoop(Core& core)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(core.index % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+            CacheShard& shard = m_cache.shard(core.index);
+            struct epoll_event events[256];
+            while (!m_stop)
+            {
+                int n = epoll_wait(core.epoll_fd, events, 256, -1);
+                g_client_syscalls++;
+                if (n < 0 && errno != EINTR)
+                {
+                    perror("epoll_wait failed");
+                    break;
+                }
+
+                // Held for the whole batch, and never while waiting for the next one.
+                std::lock_guard<std::mutex> owned(shard.mutex);
+                t_owned_shard = &shard;
+                for (int i = 0; i < n; i++)
+                {
+                    void* ptr = events[i].data.ptr;
+                    if (ptr == nullptr) drainInbox(core);
+                    else if (ptr == &core) acceptAll(core);
+                    else 
+                    {
+                        CoreConnection* conn = static_cast<CoreConnection*>(ptr);
+                        if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) conn->unread = true;
+                        serve(core, conn);
+                    }
+                }
+                t_owned_shard = nullptr;
+            }
+        }
+
+        static int openListener(int port)
+        {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            if (fd < 0) return -1;
+            int opt = 1;
+            struct sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = INADDR_ANY;
+            address.sin_port = htons(port);
+            if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+                setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0 ||
+                bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+                listen(fd, SOMAXCONN) < 0) 
+            {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+    public:
+        // The cache must have one shard per core: shard i is the one core i owns.
+        explicit PerCoreServer(ShardedCache& cache) : m_cache(cache) {}
+
+        // first_listener is the SO_REUSEPORT socket main already bound; core 0 takes a duplicate of it, since
+        // a listener in the group that nobody accepts on would strand the connections the kernel gives it.
+        bool start(int first_listener)
+        {
+            for (size_t i = 0; i < m_cache.size(); i++)
+            {
+                std::unique_ptr<Core> core(new Core());
+                core->index = i;
+                core->listen_fd = i == 0 ? dup(first_listener) : openListener(FRONTEND_PORT);
+                core->epoll_fd = epoll_create1(0);
+                core->wake_fd = eventfd(0, EFD_NONBLOCK);
+                if (core->listen_fd < 0 || core->epoll_fd < 0 || core->wake_fd < 0) 
+                {
+                    perror("per-core listener setup failed");
+                    return false;
+                }
+                fcntl(core->listen_fd, F_SETFL, fcntl(core->listen_fd, F_GETFL, 0) | O_NONBLOCK);
+
+                struct epoll_event ev = {};
+                ev.events = EPOLLIN;
+                ev.data.ptr = core.get();
+                struct epoll_event wake = {};
+                wake.events = EPOLLIN;
+                wake.data.ptr = nullptr;
+                if (epoll_ctl(core->epoll_fd, EPOLL_CTL_ADD, core->listen_fd, &ev) < 0 ||
+                    epoll_ctl(core->epoll_fd, EPOLL_CTL_ADD, core->wake_fd, &wake) < 0) 
+                {
+                    perror("epoll setup failed");
+                    return false;
+                }
+                m_cores.push_back(std::move(core));
+            }
+            for (std::unique_ptr<Core>& core : m_cores) core->thread = std::thread(&PerCoreServer::coreLoop, this, std::ref(*core));
+            return true;
+        }
+
+        // Hands a message to a core, from any thread. Only the first message into an empty inbox needs a
+        // wakeup; the rest ride along with it.
+        void post(size_t to, CoreMessage* message)
+        {
+            Core& core = *m_cores[to];
+            if (!core.inbox.push(message)) return;
+            uint64_t one = 1;
+            g_client_syscalls++;
+            if (write(core.wake_fd, &one, sizeof(one)) < 0) perror("eventfd write failed");
+        }
+
+        // Takes the request if another core owns its key, or if it is a /get or /delete of this core's that
+        // turns out to need the backend.
+        bool forward(CoreConnection* conn, const HttpRequest& request, ResponseBatch& responses)
+        {
+            std::string_view path = request.path;
+            if (path != "get" && path != "set" && path != "delete") return false;
+            std::string_view query = request.query.empty() && request.method == "POST" ? request.body : request.query;
+            size_t keyPos = query.find("key=");
+            if (keyPos == std::string_view::npos) return false;
+            keyPos += 4;
+            // The key runs to the end for /get and /delete, and to the next parameter for /set, as their handlers read it.
+            size_t keyEnd = path == "set" ? query.find('&', keyPos) : std::string_view::npos;
+            std::string_view key = urlDecode(query.substr(keyPos, keyEnd == std::string_view::npos ? std::string_view::npos : keyEnd - keyPos), t_request_arena);
+
+            size_t owner = m_cache.shardIndex(hashKey(key));
+            if (owner == conn->core && path == "set") return false;
+
+            std::string http_status = "200 OK";
+            ResponseBody body;
+            BackendWait wait;
+            KeyStep step = KeyStep::ANSWERED;
+            if (owner == conn->core) 
+            {
+                step = beginKeyRequest(path, query, m_cache, http_status, body, wait);
+                if (step == KeyStep::ANSWERED) 
+                {
+                    responses.add(http_status, std::move(body), request.keep_alive);
+                    return true;
+                }
+            }
+
+            CoreMessage* message = new CoreMessage();
+            message->conn = conn;
+            message->owner = owner;
+            message->slot = responses.reserve();
+            message->keep_alive = request.keep_alive;
+            message->path = std::string(path);
+            message->query = std::string(query);
+            if (owner != conn->core) 
+            {
+                m_cores[conn->core]->forwarded_out++;
+                post(owner, message);
+                return true;
+            }
+            message->wait = std::move(wait);
+            if (!park(*m_cores[owner], message, step)) post(owner, message);
+            return true;
+        }
+
+        // Stops the cores; messages still in flight are dropped. Connections still open are left open (and
+        // registered via add_socket) for the caller to say goodbye on.
+        void stop()
+        {
+            m_stop = true;
+            uint64_t one = 1;
+            for (std::unique_ptr<Core>& core : m_cores) 
+            {
+                if (write(core->wake_fd, &one, sizeof(one)) < 0) perror("eventfd write failed");
+            }
+            for (std::unique_ptr<Core>& core : m_cores) core->thread.join();
+        }
+
+        std::string describe()
+        {
+            long open = 0, accepted = 0, forwarded = 0, wakeups = 0, messages = 0;
+            std::ostringstream per_core;
+            for (std::unique_ptr<Core>& core : m_cores) 
+            {
+                open += core->open;
+                accepted += core->accepted;
+                forwarded += core->forwarded_out;
+                wakeups += core->wakeups;
+                messages += core->messages;
+                per_core << "Core " << core->index << ": " << core->accepted << " accepted, " << core->open << " open, " << core->forwarded_out
+                         << " requests forwarded, " << core->answered_for_others << " answered for other cores, " << core->backend_waits << " backend requests and "
+                         << core->joined << " waits on another request's fetch answered without holding the core\n";
+            }
+            std::ostringstream out;
+            out << "Per-core listeners: " << m_cores.size() << " cores, " << open << " connections open (" << accepted << " accepted), "
+                << forwarded << " requests forwarded to the owning core, " << (wakeups > 0 ? (double)messages / wakeups : 0.0) << " messages per inbox wakeup\n";
+            out << per_core.str();
+            return out.str();
+        }
+};
 
-    full_response.append(buffer, bytes_read);
+bool CoreConnection::forward(const HttpRequest& request, ResponseBatch& batch)
+{
+    return server->forward(this, request, batch);
+}
 
-    size_t status_start = full_response.find("HTTP/1.1 ");
-    size_t status_end = full_response.find("\r\n");
-    if (status_start != std::string::npos && status_end != std::string::npos) 
-    {
-        http_status = full_response.substr(status_start + 9, status_end - (status_start + 9));
-    } 
-    else 
+// On the owning core, which is finishing the fetch.
+void CoreMessage::fetched(const InFlightFetch& fetch)
+{
+    if (fetch.invalidated) 
     {
-        http_status = "500 Internal Server Error";
-        return "Error: Malformed response from Backend.";
+        kind = REQUEST;
+        conn->server->post(owner, this);
+        return;
     }
-
-    return getResponseBody(full_response);
+    kind = REPLY;
+    status = "200 OK";
+    body = coalescedAnswer(*wait.shard, fetch, wait.key, status);
+    conn->server->post(conn->core, this);
 }
 
-void writeToBackendDB(Node *node, std::string& http_status)
-{
-    if(!node->dirty) return;
-
-    std::cout << "[INFO] Writing dirty key to Backend DB on eviction/flush: " << node->key << std::endl;
+EventLoop* g_event_loop = nullptr;
+IoUringEngine* g_io_uring = nullptr;
+PerCoreServer* g_per_core = nullptr;
 
-    std::string path_and_query = "/db_set?key=" + urlEncode(node->key) + "&value=" + urlEncode(node->value);
+std::string describeEventLoop()
+{
+    std::ostringstream out;
+    if (g_io_uring != nullptr) out << g_io_uring->describe();
+    else if (g_per_core != nullptr) out << g_per_core->describe();
+    else if (g_event_loop != nullptr) out << g_event_loop->describe();
+    else out << "Event loop: off (one worker per connection)\n";
+    out << "Client connections: " << g_client_requests << " requests, " << g_client_syscalls << " syscalls ("
+        << (g_client_requests > 0 ? (double)g_client_syscalls / g_client_requests : 0.0) << " per request)\n";
+    out << "Response assembly: " << g_response_bytes_copied << " bytes copied ("
+        << (g_client_requests > 0 ? (double)g_response_bytes_copied / g_client_requests : 0.0) << " per request), "
+        << g_zero_copy_responses << " bodies sent from the cache in place (" << g_prepared_sends << " as prepared responses), " << g_pin_saturated << " copied because the entry was pinned too often\n";
+    return out.str();
+}
 
-    std::string backend_response = sendToBackend(path_and_query, http_status);
+int openPerfCounter(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
 
-    if (http_status.rfind("200 OK", 0) == 0)
-    {
-        node->dirty = false;
-    } else 
-    {
-        std::cerr << "[ERROR] Backend Write Failed (" << http_status << "): " << backend_response << std::endl;
-    }
+long readPerfCounter(int fd)
+{
+    long long value = 0;
+    if(fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) return -1;
+    return static_cast<long>(value);
 }
 
-std::string handle_set(const std::string& query, KeyValueStore& store, std::string& http_status)
+// Microbenchmark of the cache hit path (hash, index probe, LRU relink, value copy) over a working set
+// larger than the LLC. Runs without a backend: ./frontend --bench-hitpath [entries] [value_bytes]
+int run_hitpath_benchmark(size_t entries, size_t value_size)
 {
-    g_total_access++;
-    std::lock_guard<std::mutex> lock(g_store_mutex);
+    const size_t lookups = 2000000;
 
-    size_t keyPos = query.find("key=");
-    size_t valPos = query.find("value=");
+    ShardedCache cache(1, entries * (Node::chunkSize(16, value_size) + CACHE_LINE_SIZE + sizeof(IndexSlot)));
+    CacheShard& shard = cache.shard(0);
+    std::vector<std::string> keys;
+    keys.reserve(entries);
 
-    if(keyPos == std::string::npos || valPos == std::string::npos) 
+    std::string value(value_size, 'v');
+    for(size_t i = 0; i < entries; i++) 
     {
-        http_status = "400 Bad Request";
-        return "Error missing 'key' or 'value' parameter for /set.";
+        keys.push_back("key" + std::to_string(i));
+        insertNode(shard, keys.back(), value, hashKey(keys.back()), false);
     }
 
-    keyPos += 4;
-    valPos += 6;
+    std::vector<uint32_t> order(lookups);
+    uint32_t seed = 12345;
+    for(size_t i = 0; i < lookups; i++) 
+    {
+        seed = seed * 1103515245 + 12345;
+        order[i] = (seed >> 8) % entries;
+    }
 
-    std::string key = urlDecode(query.substr(keyPos, query.find("&", keyPos) - keyPos));
-    std::string value = urlDecode(query.substr(valPos));
+    int fd_llc = openPerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    int fd_l1d = openPerfCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    if(fd_llc < 0 || fd_l1d < 0) 
+    {
+        perror("[WARN] perf_event_open failed, reporting timings only");
+    }
 
-    auto it = store.find(key);
+    std::string value_copy;
+    value_copy.reserve(value_size);
+    size_t found = 0;
 
-    if(it != store.end())
+    for(int fd : {fd_llc, fd_l1d}) 
     {
-        g_cache_hits++;
-        Node* foundNode = it->second;
-        std::cout << "[INFO] Cache Hit for Set. Updating Key: " << key << std::endl;
-
-        foundNode->value = value;
-        foundNode->dirty = true; 
-        foundNode->moveToFront(head);
+        if(fd >= 0) { ioctl(fd, PERF_EVENT_IOC_RESET, 0); ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); }
     }
-    else
-    {
-        //std::cout << "[INFO] Cache MISS for SET. Adding Key: " << key << std::endl;
+    auto t0 = std::chrono::steady_clock::now();
 
-        if(count_of_pairs == N)
+    for(size_t i = 0; i < lookups; i++) 
+    {
+        const std::string& key = keys[order[i]];
+        uint64_t hash = hashKey(key);
+        Node* node = shard.store.find(key, hash);
+        if(node != nullptr) 
         {
-            Node* node_to_evict = tail->prev;
-            //std::cout << "[INFO] Cache full. Evicting LRU key: " << node_to_evict->key << std::endl;
-            writeToBackendDB(node_to_evict, http_status);
-            detachNode(node_to_evict);
-            store.erase(node_to_evict->key);
-            delete node_to_evict;
-            count_of_pairs--;
+            shard.policy->onHit(node);
+            value_copy.assign(node->value());
+            found++;
         }
-
-        Node* newNode = new Node(key, value);
-        newNode->dirty = true;
-        attachToFront(newNode);
-        store[key] = newNode;
-        count_of_pairs++;
     }
 
-    //std::cout << "[LOG] Set Key " << key << " to " << value << " (in cache and marked dirty)" << std::endl;
-    return "OK: Key " + key + " was set (in cache and marked dirty)";
-}
-
-std::string handle_get(const std::string& query, KeyValueStore& store, std::string& http_status)
-{
-    g_total_access++;
-    std::string value_copy;
-    bool found = false;
-
-    size_t keyPos = query.find("key=");
-    if(keyPos == std::string::npos) 
+    auto t1 = std::chrono::steady_clock::now();
+    for(int fd : {fd_llc, fd_l1d}) 
     {
-        http_status = "400 Bad Request";
-        return "Error missing 'key' parameter for /get.";
+        if(fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
     }
 
-    keyPos += 4;
-    std::string key = urlDecode(query.substr(keyPos));
+    long llc_misses = readPerfCounter(fd_llc);
+    long l1d_misses = readPerfCounter(fd_l1d);
+    if(fd_llc >= 0) close(fd_llc);
+    if(fd_l1d >= 0) close(fd_l1d);
 
-    {
-        //std::lock_guard<std::mutex> lock(g_store_mutex);
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
 
-        /*
-        size_t keyPos = query.find("key=");
-        if(keyPos == std::string::npos) 
-        {
-            http_status = "400 Bad Request";
-            return "Error missing 'key' parameter for /get.";
-        }
+    std::cout << "========================================" << std::endl;
+    std::cout << "          HIT PATH BENCHMARK            " << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Entries:             " << entries << " (" << value_size << " B values, " << sizeof(Node) << " B header)" << std::endl;
+    std::cout << "Lookups:             " << lookups << " (" << found << " hits)" << std::endl;
+    std::cout << "Time per lookup:     " << ns / lookups << " ns" << std::endl;
+    if(llc_misses >= 0) std::cout << "LLC misses/lookup:   " << (double)llc_misses / lookups << std::endl;
+    if(l1d_misses >= 0) std::cout << "L1D misses/lookup:   " << (double)l1d_misses / lookups << std::endl;
+    std::cout << "========================================" << std::endl;
+    return 0;
+}
 
-        keyPos += 4;
-        std::string key = urlDecode(query.substr(keyPos));
+#ifdef FRONTEND_ALLOC_COUNTING
+// Heap allocations on the GET hit path end to end: pipelined requests are parsed out of a connection
+// buffer, answered and batched, and the batch is marked sent. Hits served from prepared responses, from
+// values in place, and on keys that need URL-decoding must all run without allocating; returns 1 if any did.
+// Build with -DFRONTEND_ALLOC_COUNTING; runs without a backend: ./frontend --bench-get-allocs [requests]
+int run_get_alloc_benchmark(size_t requests)
+{
+    const size_t hot_keys = 50;
+    const size_t value_size = 512;
+    const size_t pipeline = 16;
 
-        */
+    struct Case
+    {
+        const char* name;
+        size_t prepared_entries;
+        const char* key_prefix;
+    };
+    const Case cases[] = {
+        {"Prepared responses", DEFAULT_PREPARED_RESPONSES, "key"},
+        {"Values in place", 0, "key"},
+        {"Keys past the small-string buffer", DEFAULT_PREPARED_RESPONSES, "user-profile-session-"},
+        {"URL-encoded keys", DEFAULT_PREPARED_RESPONSES, "user%3Aprofile%20session%2F"},
+    };
 
-        std::lock_guard<std::mutex> lock(g_store_mutex);
-        auto it = store.find(key);
-        if(it != store.end())
-        {
-            g_cache_hits++;
-            Node* foundNode = it->second;
-            std::cout << "[INFO] Found Key "  << key << " in Cache." << std::endl;
-            foundNode->moveToFront(head);
+    std::cout << "========================================" << std::endl;
+    std::cout << "      GET HIT ALLOCATION BENCHMARK      " << std::endl;
+    std::cout << "========================================" << std::endl;
 
-            value_copy = foundNode->value;
-            found = true;
-            //return foundNode->value;
-        }
-    }
-    if(found)
-    {
-        heavy_computation();
-        return value_copy;
-    }
-    
-    else
+    bool clean = true;
+    for(const Case& c : cases) 
     {
-        std::cout << "[INFO] Cache MISS for GET. Checking Backend Database for Key: " << key << std::endl;
-        std::string backend_status = "200 OK";
-        std::string path_and_query = "/db_get?key=" + urlEncode(key);
-        std::string value_from_db = sendToBackend(path_and_query, backend_status);
-
-        if (backend_status.rfind("200 OK", 0) == 0) 
+        ShardedCache cache(DEFAULT_NUM_SHARDS, DEFAULT_CACHE_BYTES, "lru", DEFAULT_NEGATIVE_ENTRIES, DEFAULT_NEGATIVE_TTL_MS, c.prepared_entries);
+        std::string value(value_size, 'v');
+        std::vector<std::string> batches;
+        for(size_t i = 0; i < hot_keys; i++) 
         {
-            std::cout << "[INFO] Found key in Backend DB. Inserting into Cache." << std::endl;
+            std::string key = urlDecode(c.key_prefix + std::to_string(i));
+            uint64_t hash = hashKey(key);
+            CacheShard& shard = cache.shardFor(hash);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            insertNode(shard, key, value, hash, false);
 
-            std::lock_guard<std::mutex> lock(g_store_mutex);
-            if(store.find(key) != store.end()) 
+            std::string batch;
+            for(size_t r = 0; r < pipeline; r++) 
             {
-                return store[key]->value; 
+                batch += "GET /get?key=" + std::string(c.key_prefix) + std::to_string((i + r) % hot_keys) + " HTTP/1.1\r\nHost: bench\r\n\r\n";
             }
+            batches.push_back(batch);
+        }
 
-            if(count_of_pairs == N)
+        ConnectionBuffer input;
+        HttpRequestParser parser;
+        ResponseBatch responses;
+        size_t bytes = 0;
+        auto run = [&](size_t count) 
+        {
+            for(size_t done = 0; done < count; done += pipeline) 
             {
-                Node* node_to_evict = tail->prev;
-                std::cout << "[INFO] Cache full. Evicting LRU key: " << node_to_evict->key << std::endl;
-                writeToBackendDB(node_to_evict, http_status);
-                detachNode(node_to_evict);
-                store.erase(node_to_evict->key);
-                delete node_to_evict;
-                count_of_pairs--;
+                const std::string& batch = batches[(done / pipeline) % batches.size()];
+                size_t room = 0;
+                memcpy(input.prepare(room), batch.data(), batch.size());
+                input.commit(batch.size());
+                answerRequests(input, parser, responses, cache);
+                struct msghdr* msg = responses.unsent();
+                for(size_t i = 0; i < msg->msg_iovlen; i++) bytes += msg->msg_iov[i].iov_len;
+                responses.sent(SIZE_MAX);
             }
+        };
 
-            Node* newNode = new Node(key, value_from_db);
-            newNode->dirty = false;
-            attachToFront(newNode);
-            store[key] = newNode;
-            count_of_pairs++;
+        // The handlers log every hit; the warm-up sizes the buffers and builds the prepared responses.
+        std::cout.setstate(std::ios::failbit);
+        run(hot_keys * pipeline * 2);
+        bytes = 0;
+        long before = t_heap_allocations;
+        auto t0 = std::chrono::steady_clock::now();
+        run(requests);
+        auto t1 = std::chrono::steady_clock::now();
+        long allocations = t_heap_allocations - before;
+        std::cout.clear();
 
-            return value_from_db;
-        }
-        else
-        {
-            http_status = backend_status;
-            std::cout << "[LOG] Key " << key << " not found in Backend DB (" << backend_status << ")." << std::endl;
-            return "Error: Key : " + key + " Not Found.";
-        }
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        std::cout << c.name << ": " << requests << " hits, " << allocations << " heap allocations (" << (double)allocations / requests
+                  << " per hit), " << bytes / requests << " response bytes per hit, " << ns / requests << " ns per hit" << std::endl;
+        if(allocations != 0) clean = false;
     }
+
+    std::cout << "========================================" << std::endl;
+    std::cout << (clean ? "PASS: GET hits allocate nothing" : "FAIL: GET hits allocated") << std::endl;
+    return clean ? 0 : 1;
 }
+#endif
 
-std::string handle_delete(const std::string& query, KeyValueStore& store, std::string& http_status)
+// GET_POPULAR-shaped stress run: readers hit a small hot set while one writer keeps replacing, deleting
+// and re-inserting the same keys. Every value starts with its own key, so a reader that ever copies a
+// recycled or half-written node is counted as a corrupt read. Values also carry the writer's version,
+// which only grows across sets, deletes and re-inserts; a reader that sees a key's version go backwards
+// read a replaced or deleted entry after its successor and counts a stale read. Each reader count runs
+// once with lookups forced through the shard mutex and once on the lock-free path. Exits non-zero on
+// any corrupt or stale read.
+// Runs without a backend: ./frontend [--policy P] --bench-concurrent [max_readers] [seconds]
+int run_concurrency_benchmark(int max_readers, double seconds, const std::string& policy_name)
 {
-    g_total_access++;
+    const size_t hot_keys = 50;
+    const size_t value_size = 512;
 
-    std::lock_guard<std::mutex> lock(g_store_mutex);
-
-    size_t keyPos = query.find("key=");
-    if(keyPos == std::string::npos) {
-        http_status = "400 Bad Request";
-        return "Error missing 'key' parameter for /delete.";
+    ShardedCache cache(DEFAULT_NUM_SHARDS, DEFAULT_CACHE_BYTES, policy_name);
+    std::vector<std::string> keys;
+    std::vector<uint64_t> hashes;
+    for(size_t i = 0; i < hot_keys; i++) 
+    {
+        keys.push_back("popular_key_" + std::to_string(i));
+        hashes.push_back(hashKey(keys.back()));
     }
-    keyPos += 4;
-    std::string key = urlDecode(query.substr(keyPos));
 
-    auto it = store.find(key);
-    if(it != store.end())
+    auto makeValue = [&](size_t i, uint64_t version) {
+        std::string value = keys[i] + ":" + std::to_string(version);
+        value.resize(value_size, 'v');
+        return value;
+    };
+
+    for(size_t i = 0; i < hot_keys; i++) 
     {
-        g_cache_hits++;
-        Node* node_to_delete = it->second;
-        detachNode(node_to_delete);
-        store.erase(it);
-        delete node_to_delete;
-        count_of_pairs--;
-        std::cout << "[LOG] Deleted Key " << key << " from in-Memory Cache." << std::endl;
+        CacheShard& shard = cache.shardFor(hashes[i]);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        insertNode(shard, keys[i], makeValue(i, 0), hashes[i], false);
     }
 
-    std::cout << "[INFO] Deleting Key " << key << " from Backend DB." << std::endl;
-    std::string backend_status = "200 OK";
-    std::string path_and_query = "/db_delete?key=" + urlEncode(key);
-    std::string backend_response = sendToBackend(path_and_query, backend_status);
+    std::cout << "========================================" << std::endl;
+    std::cout << "       CONCURRENT READ BENCHMARK        " << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Hot keys: " << hot_keys << ", " << value_size << " B values, policy " << cache.policyName()
+              << ", 1 writer (replace/delete/insert)" << std::endl;
 
-    if (backend_status.rfind("200 OK", 0) != 0) 
+    long total_bad = 0;
+    // Carried across runs: values left over from the previous run must not outrank the next run's writes.
+    uint64_t version = 1;
+    for(int readers = 1; readers <= max_readers; readers *= 2) 
     {
-        http_status = backend_status;
-        return "Error: Failed to delete key from Backend DB: " + backend_response;
-    }
+        for(bool lock_free : {false, true}) 
+        {
+            std::atomic<bool> stop{false};
+            std::atomic<long> lookups{0}, hits{0}, corrupt{0}, stale{0}, writes{0};
 
-    return "Key: " + key + " deleted (from cache and DB)";
-}
+            std::thread writer([&]() {
+                uint32_t seed = 777;
+                while(!stop.load(std::memory_order_relaxed)) 
+                {
+                    seed = seed * 1103515245 + 12345;
+                    size_t i = (seed >> 8) % hot_keys;
+                    CacheShard& shard = cache.shardFor(hashes[i]);
+                    std::lock_guard<std::mutex> lock(shard.mutex);
 
-void flushAllToDB(KeyValueStore& store, std::string& http_status)
-{
-    std::lock_guard<std::mutex> lock(g_store_mutex);
+                    Node* node = shard.store.find(keys[i], hashes[i]);
+                    if(node != nullptr && (seed >> 24) % 4 == 0) 
+                    {
+                        shard.policy->onRemove(node);
+                        releaseNode(shard, node);
+                    }
+                    else if(node != nullptr) 
+                    {
+                        replaceNode(shard, node, makeValue(i, version++));
+                    }
+                    else if(makeRoom(shard, shard.entryCharge(keys[i].size(), value_size), hashes[i])) 
+                    {
+                        insertNode(shard, keys[i], makeValue(i, version++), hashes[i], false);
+                    }
+                    writes++;
+                }
+            });
 
-    std::cout << "[INFO] Flushing all dirty nodes to Backend DB during shutdown..." << std::endl;
-    Node* current = head->next;
-    int count = 0;
+            std::vector<std::thread> pool;
+            for(int r = 0; r < readers; r++) 
+            {
+                pool.emplace_back([&, r]() {
+                    uint32_t seed = 12345 + r;
+                    long local_lookups = 0, local_hits = 0, local_corrupt = 0, local_stale = 0;
+                    std::vector<uint64_t> last_version(hot_keys, 0);
+                    std::string value;
+                    while(!stop.load(std::memory_order_relaxed)) 
+                    {
+                        seed = seed * 1103515245 + 12345;
+                        size_t i = (seed >> 8) % hot_keys;
+                        CacheShard& shard = cache.shardFor(hashes[i]);
 
-    while (current != tail)
-    {
-        if (current->dirty)
-        {
-            writeToBackendDB(current, http_status);
-            if (http_status.rfind("200 OK", 0) == 0) {
-                count++;
-                current->dirty = false;
+                        bool hit = false;
+                        if(lock_free) 
+                        {
+                            hit = lookupLockFree(shard, keys[i], hashes[i], [&](Node* node) { value.assign(node->value()); });
+                        }
+                        if(!hit) 
+                        {
+                            std::lock_guard<std::mutex> lock(shard.mutex);
+                            Node* node = shard.store.find(keys[i], hashes[i]);
+                            if(node != nullptr) 
+                            {
+                                shard.policy->onHit(node);
+                                value.assign(node->value());
+                                hit = true;
+                            }
+                        }
+
+                        local_lookups++;
+                        if(hit) 
+                        {
+                            local_hits++;
+                            if(value.size() != value_size || value.compare(0, keys[i].size() + 1, keys[i] + ":") != 0) 
+                            {
+                                local_corrupt++;
+                                continue;
+                            }
+                            uint64_t version = strtoull(value.c_str() + keys[i].size() + 1, nullptr, 10);
+                            if(version < last_version[i]) local_stale++;
+                            else last_version[i] = version;
+                        }
+                    }
+                    lookups += local_lookups;
+                    hits += local_hits;
+                    corrupt += local_corrupt;
+                    stale += local_stale;
+                });
             }
+
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+            stop = true;
+            for(std::thread& t : pool) t.join();
+            writer.join();
+            total_bad += corrupt + stale;
+
+            std::cout << "Readers " << readers << (lock_free ? ", lock-free: " : ", locked:    ")
+                      << (long)(lookups / seconds) << " lookups/s, " << (lookups > 0 ? hits * 100.0 / lookups : 0.0) << "% hits, "
+                      << (long)(writes / seconds) << " writes/s, " << corrupt << " corrupt reads, " << stale << " stale reads" << std::endl;
         }
-        current = current->next;
     }
-    std::cout << "[INFO] Flushed " << count << " dirty nodes to Backend." << std::endl;
+    std::cout << "========================================" << std::endl;
+    return total_bad == 0 ? 0 : 1;
 }
 
-void signal_handler(int signum) 
+// A whole-number flag value: digits only (no sign, no suffix) and within [min_value, max_value].
+bool parseCount(const std::string& text, unsigned long long min_value, unsigned long long max_value, unsigned long long& out)
 {
-    std::cout << "\n[INFO] SIGINT (Ctrl+C) received. Initiating shutdown..." << std::endl;
-    g_shutdown_flag = 1;
-
-
-    if(g_server_fd != -1)
+    if(text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    try 
     {
-        close(g_server_fd);
-        g_server_fd = -1;
+        out = std::stoull(text);
+    }
+    catch(const std::out_of_range&) 
+    {
+        return false;
     }
+    return out >= min_value && out <= max_value;
 }
 
-void handle_client(int new_socket, KeyValueStore& store);
-
-void worker_function(ThreadSafeQueue& queue, KeyValueStore& store) 
+bool parseSeconds(const std::string& text, double& out)
 {
-    std::thread::id thread_id = std::this_thread::get_id();
-    std::cout << "[INFO] Worker Thread " << thread_id  <<" starting." << std::endl;;
-
-    while(true) 
+    size_t used = 0;
+    try 
     {
-        int new_socket = queue.pop();
-        if(new_socket == -1) 
-        {
-            std::cout << "[INFO] Worker thread " << thread_id << " exiting." << std::endl;
-            break;
-        }
-        std::cout << "[INFO] Worker thread " << thread_id << " handling a new client." << std::endl;
-        handle_client(new_socket, store);
+        out = std::stod(text, &used);
     }
+    catch(const std::exception&) 
+    {
+        return false;
+    }
+    return used == text.size() && out > 0 && out <= 3600;
 }
 
-void handle_client(int new_socket, KeyValueStore& store)
+int main(int argc, char* argv[])
 {
+    int num_shards = DEFAULT_NUM_SHARDS;
+    size_t cache_bytes = DEFAULT_CACHE_BYTES;
+    std::string policy_name = "lru";
+    size_t negative_entries = DEFAULT_NEGATIVE_ENTRIES;
+    uint64_t negative_ttl_ms = DEFAULT_NEGATIVE_TTL_MS;
+    size_t prepared_entries = DEFAULT_PREPARED_RESPONSES;
+    size_t key_filter_bits = DEFAULT_KEY_FILTER_BITS;
+    int num_workers = NUM_THREADS;
+    int io_threads = 0;
+    int uring_rings = 0;
+    int reuseport_cores = 0;
 
-    add_socket(new_socket);
-    char client_ip[INET_ADDRSTRLEN];
-    struct sockaddr_in client_address;
-    socklen_t client_addrlen = sizeof(client_address);
-
-    getpeername(new_socket, (sockaddr*)&client_address, &client_addrlen);
-
-    inet_ntop(AF_INET, &client_address.sin_addr, client_ip, INET_ADDRSTRLEN);
-    int client_port = ntohs(client_address.sin_port);
-
-    std::cout << "[INFO] Thread " << std::this_thread::get_id() <<" handling client from " <<client_ip << ":" <<client_port<< std::endl;
-
-    while (true)
+    // Reads the value after the current flag into `value`; a missing or bad one falls through to the usage text.
+    unsigned long long value = 0;
+    std::string bad_value;
+    int i = 1;
+    auto count = [&](unsigned long long min_value, unsigned long long max_value) 
     {
-        char buffer[BUFFER_SIZE] = {0};
-        int bytes_read = read(new_socket, buffer, BUFFER_SIZE);
-
-        if (bytes_read <= 0) break;
-
-        std::string request(buffer);
-        std::string response_body;
-        std::string http_status = "200 OK";
-        bool keep_alive = true;
-
-        size_t start = request.find("GET /") + 5;
-        size_t end = request.find(" ", start);
+        if(i + 1 < argc && parseCount(argv[i + 1], min_value, max_value, value)) 
+        {
+            i++;
+            return true;
+        }
+        std::string range = max_value == ULLONG_MAX ? "of at least " + std::to_string(min_value) : "from " + std::to_string(min_value) + " to " + std::to_string(max_value);
+        bad_value = std::string(argv[i]) + " expects a whole number " + range + 
+                    (i + 1 < argc ? std::string(", got '") + argv[i + 1] + "'" : std::string(", got nothing"));
+        return false;
+    };
+    // Bench arguments are optional, so a following flag is not taken as one.
+    auto optional_count = [&](unsigned long long fallback) 
+    {
+        value = fallback;
+        return i + 1 >= argc || argv[i + 1][0] == '-' || count(1, ULLONG_MAX);
+    };
 
-        if (start == std::string::npos || end == std::string::npos)
+    for(; i < argc; i++) 
+    {
+        std::string arg = argv[i];
+        if(arg == "--shards" && count(1, MAX_SHARDS)) 
         {
-            http_status = "400 Bad Request";
-            response_body = "Error: Malformed Request"; 
+            num_shards = (int)value;
         }
-        else
+        else if(arg == "--cache-bytes" && count(1, ULLONG_MAX)) 
         {
-            std::string pathAndQuery = request.substr(start, end - start);
-            size_t queryPos = pathAndQuery.find("?");
-            std::string path = pathAndQuery.substr(0, queryPos);
-            std::string query = (queryPos != std::string::npos) ? pathAndQuery.substr(queryPos + 1) : "";
-
-            if (path == "set")
-                response_body += handle_set(query, store, http_status);
-            else if (path == "get")
-                response_body += handle_get(query, store, http_status);
-            else if (path == "delete")
-                response_body += handle_delete(query, store, http_status);
-            else if (path == "disconnect") {
-                response_body = "OK Disconnecting. ";
-                keep_alive = false;
-            }
-            else 
+            cache_bytes = value;
+        }
+        else if(arg == "--writeback-queue" && count(1, ULLONG_MAX)) 
+        {
+            g_writeback.setCapacity(value);
+        }
+        else if(arg == "--negative-entries" && count(0, ULLONG_MAX)) 
+        {
+            negative_entries = value;
+        }
+        else if(arg == "--negative-ttl" && count(0, ULLONG_MAX)) 
+        {
+            negative_ttl_ms = value;
+        }
+        else if(arg == "--prepared-responses" && count(0, ULLONG_MAX)) 
+        {
+            prepared_entries = value;
+        }
+        else if(arg == "--backend-conns" && count(1, MAX_THREADS)) 
+        {
+            g_backend_pool.setSize(value);
+        }
+        else if(arg == "--backend-depth" && count(1, ULLONG_MAX)) 
+        {
+            g_backend_pool.setDepth(value);
+        }
+        else if(arg == "--backend-timeout" && count(1, LONG_MAX)) 
+        {
+            g_backend_pool.setTimeout((long)value);
+        }
+        else if(arg == "--backend-binary") 
+        {
+            g_backend_pool.setBinary(true);
+        }
+        else if(arg == "--workers" && count(1, MAX_THREADS)) 
+        {
+            num_workers = (int)value;
+        }
+        else if(arg == "--event-loop" && count(1, MAX_THREADS)) 
+        {
+            io_threads = (int)value;
+        }
+        else if(arg == "--io-uring" && count(1, MAX_THREADS)) 
+        {
+            uring_rings = (int)value;
+        }
+        else if(arg == "--reuseport" && count(1, MAX_THREADS)) 
+        {
+            reuseport_cores = (int)value;
+        }
+        else if(arg == "--key-filter-bits" && count(0, MAX_KEY_FILTER_BITS)) 
+        {
+            key_filter_bits = value;
+        }
+        else if(arg == "--policy" && i + 1 < argc && makePolicy(argv[i + 1], 1) != nullptr) 
+        {
+            policy_name = argv[++i];
+        }
+        else if(arg == "--bench-hitpath") 
+        {
+            if(!optional_count(1000000)) break;
+            size_t entries = value;
+            if(!optional_count(16)) break;
+            size_t value_size = value;
+            return run_hitpath_benchmark(entries, value_size);
+        }
+#ifdef FRONTEND_ALLOC_COUNTING
+        else if(arg == "--bench-get-allocs") 
+        {
+            if(!optional_count(10000)) break;
+            return run_get_alloc_benchmark(value);
+        }
+#endif
+        else if(arg == "--bench-concurrent") 
+        {
+            if(!optional_count(NUM_THREADS)) break;
+            int readers = (int)std::min<unsigned long long>(value, MAX_THREADS);
+            double seconds = 2.0;
+            if(i + 1 < argc && argv[i + 1][0] != '-' && !parseSeconds(argv[++i], seconds)) 
             {
-                http_status = "400 Bad Request";
-                response_body = "Usage: /set, /get, /delete, /disconnect\n";
+                bad_value = std::string("--bench-concurrent expects seconds in (0, 3600], got '") + argv[i] + "'";
+                break;
             }
+            return run_concurrency_benchmark(readers, seconds, policy_name);
+        }
+        else 
+        {
+            break;
         }
-
-        std::string http_response = "HTTP/1.1 " + http_status + "\r\n";
-        http_response += "Content-Type: text/plain\r\n";
-        http_response += "Content-Length: " + std::to_string(response_body.length()) + "\r\n";
-        http_response += (keep_alive) ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
-        http_response += "\r\n";
-        http_response += response_body;
-
-        send(new_socket, http_response.c_str(), http_response.length(), 0);
-
-        if (!keep_alive) break;
+    }
+    if(i < argc) 
+    {
+        if(!bad_value.empty()) std::cerr << "[ERROR] " << bad_value << std::endl;
+        else std::cerr << "[ERROR] Unknown or incomplete argument: " << argv[i] << std::endl;
+        std::cout << "Usage: ./frontend [--shards <N>] [--cache-bytes <B>] [--policy lru|clock|tinylfu|arc] [--writeback-queue <keys>] [--negative-entries <N>] [--negative-ttl <ms>] [--prepared-responses <entries, 0 = off>] [--key-filter-bits <bits per key, 0 = off>] [--backend-conns <N>] [--backend-depth <requests per connection>] [--backend-timeout <ms>] [--backend-binary] [--workers <N>] [--event-loop <I/O threads>] [--io-uring <rings>] [--reuseport <cores>] | --bench-hitpath [entries] [value_bytes] | --bench-concurrent [max_readers] [seconds]"
+#ifdef FRONTEND_ALLOC_COUNTING
+                  << " | --bench-get-allocs [requests]"
+#endif
+                  << std::endl;
+        return 1;
     }
 
-    remove_socket(new_socket);
-    close(new_socket);
-    std::cout << "[INFO] Thread " << std::this_thread::get_id() << " finished. Closing Connection." << std::endl;
-}
-
-int main()
-{
-    head->next = tail;
-    tail->prev = head;
+    // Per-core listeners replace the other serving modes rather than combining with them.
+    if(reuseport_cores > 0) 
+    {
+        uring_rings = 0;
+        io_threads = 0;
+    }
 
     struct sigaction sa;
     memset(&sa, 0, sizeof(sa));
@@ -634,12 +6817,20 @@ int main()
         return 1;
     }
 
-    if (!connectToBackend()) 
+    size_t backend_up = g_backend_pool.connect();
+    if (backend_up == 0) 
     {
         std::cerr << "[FATAL] Failed to connect to Backend DB. Shutting down Frontend." << std::endl;
         return 1;
     }
 
+    // Loaded before any client is accepted; sets made while it loads would reach the new table anyway.
+    if(key_filter_bits > 0) 
+    {
+        g_key_filter.setBitsPerKey(key_filter_bits);
+        buildKeyFilter(nullptr, DEFAULT_KEY_FILTER_MIN_KEYS);
+    }
+
     g_server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if(g_server_fd < 0) 
     { 
@@ -648,7 +6839,8 @@ int main()
     }
 
     int opt = 1;
-    if (setsockopt(g_server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) 
+    if (setsockopt(g_server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+        (reuseport_cores > 0 && setsockopt(g_server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)))) 
     {
         perror("setsockopt failed");
         close(g_server_fd);
@@ -667,7 +6859,7 @@ int main()
         return 1;
     }
 
-    if(listen(g_server_fd, 100) < 0) 
+    if(listen(g_server_fd, SOMAXCONN) < 0) 
     {
         perror("Listen failed");
         close(g_server_fd);
@@ -675,20 +6867,74 @@ int main()
     }
 
     std::cout << "Key-Value FRONTEND Server Listening on port " << FRONTEND_PORT << std::endl;
-    std::cout << "Backend DB connected at " << BACKEND_IP << ":" << BACKEND_PORT << std::endl;
+    std::cout << "Backend DB connected at " << BACKEND_IP << ":" << (g_backend_pool.binary() ? BACKEND_BINARY_PORT : BACKEND_PORT) << " (" << backend_up << "/" << g_backend_pool.size() << " pooled connections)" << std::endl;
 
-    KeyValueStore keyValueStore;
-    ThreadSafeQueue task_queue;
+    // Per-core serving gives every core exactly one shard of its own.
+    if(reuseport_cores > 0) num_shards = reuseport_cores;
+    ShardedCache cache(num_shards, cache_bytes, policy_name, negative_entries, negative_ttl_ms, prepared_entries);
+    std::cout << "[INFO] Cache budget " << cache_bytes << " bytes split across " << cache.size() << " shards, eviction policy " << cache.policyName() << "." << std::endl;
+
+    ThreadSafeQueue<int> task_queue;
     std::vector<std::thread> thread_pool;
+    EventLoop event_loop(cache);
+    IoUringEngine uring_engine(cache);
+    PerCoreServer per_core(cache);
+
+    auto serve_start = std::chrono::steady_clock::now();
+    if(uring_rings > 0) 
+    {
+        std::string reason;
+        if(uring_engine.start(uring_rings, reason)) 
+        {
+            std::cout << "[INFO] Serving clients with " << uring_rings << " io_uring rings." << std::endl;
+            g_io_uring = &uring_engine;
+        }
+        else 
+        {
+            std::cout << "[WARN] io_uring unavailable (" << reason << "), falling back to the epoll event loop." << std::endl;
+            io_threads = uring_rings;
+            uring_rings = 0;
+        }
+    }
+    if(reuseport_cores > 0) 
+    {
+        std::cout << "[INFO] Starting " << reuseport_cores << " per-core SO_REUSEPORT listeners, each owning one cache shard." << std::endl;
+        if(!per_core.start(g_server_fd)) return 1;
+        g_per_core = &per_core;
+    }
+    else if(uring_rings == 0 && io_threads > 0) 
+    {
+        std::cout << "[INFO] Starting event loop with " << io_threads << " I/O threads and " << num_workers << " workers." << std::endl;
+        if(!event_loop.start(io_threads, num_workers)) return 1;
+        g_event_loop = &event_loop;
+    }
+    else if(uring_rings == 0) 
+    {
+        std::cout << "[INFO] Starting Thread Pool with " << num_workers << " threads." << std::endl;
 
-    std::cout << "[INFO] Starting Thread Pool with " << NUM_THREADS << " threads." << std::endl;
+        for(int i=0; i<num_workers; i++) 
+        {
+            thread_pool.emplace_back(worker_function, 
+                std::ref(task_queue), 
+                std::ref(cache)
+            );
+        }
+    }
+    std::thread expiry_thread(expiry_function, std::ref(cache));
+    std::thread health_thread(&BackendPool::healthLoop, &g_backend_pool);
+    std::thread key_filter_thread;
+    if(g_key_filter.ready()) key_filter_thread = std::thread(key_filter_function, std::ref(cache), (size_t)DEFAULT_KEY_FILTER_MIN_KEYS);
+
+    std::vector<std::thread> flusher_threads;
+    for(int i = 0; i < WRITEBACK_FLUSHERS; i++) 
+    {
+        flusher_threads.emplace_back(&WriteBackQueue::flusherLoop, &g_writeback);
+    }
 
-    for(int i=0; i<NUM_THREADS; i++) 
+    // The rings and cores accept for themselves; main only waits for the signal.
+    while((uring_rings > 0 || reuseport_cores > 0) && !g_shutdown_flag) 
     {
-        thread_pool.emplace_back(worker_function, 
-            std::ref(task_queue), 
-            std::ref(keyValueStore)
-        );
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
     while(!g_shutdown_flag)
@@ -698,6 +6944,7 @@ int main()
         int new_socket = -1;
 
         new_socket = accept(g_server_fd, (struct sockaddr *)&client_address, &client_addrlen);
+        g_client_syscalls++;
 
         if(new_socket < 0)
         {
@@ -709,13 +6956,23 @@ int main()
             continue;
         }
 
+        if(io_threads > 0) 
+        {
+            event_loop.add(new_socket);
+            continue;
+        }
         std::cout << "[INFO] Main Thread accepted new connection. Pushing to Queue. " << std::endl;
         task_queue.push(new_socket);
     }
 
+    double serve_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - serve_start).count();
     std::cout << "\n[INFO] Server shutting down." << std::endl;
 
     std::cout << "[INFO] Stopping task queue and notifying workers... " << std::endl;
+    // Event-loop workers never block on a client, so they are stopped before the sockets are closed under them.
+    if(io_threads > 0) event_loop.stop();
+    if(uring_rings > 0) uring_engine.stop();
+    if(reuseport_cores > 0) per_core.stop();
     {
         std::lock_guard<std::mutex> lock(g_active_socket_list_mutex);
     
@@ -742,26 +6999,21 @@ int main()
         t.join();
     }
     std::cout << "[INFO] All worker threads have exited." << std::endl;
+    expiry_thread.join();
+    if(key_filter_thread.joinable()) key_filter_thread.join();
 
-    std::string dummy;
-    flushAllToDB(keyValueStore, dummy);
-
-    Node* current = head->next;
-    while(current != tail) 
+    flushAllToDB(cache);
+    g_writeback.stop();
+    for(std::thread& t : flusher_threads) 
     {
-        Node* to_delete = current;
-        current = current->next;
-        delete to_delete;
+        t.join();
     }
-    delete head;
-    delete tail;
+
+    g_backend_pool.stop();
+    health_thread.join();
 
     close(g_server_fd);
-    
-    if (g_backend_sock != -1) 
-    {
-        close(g_backend_sock);
-    }
+    g_backend_pool.closeAll();
 
 
     std::cout << "\n========================================" << std::endl;
@@ -777,8 +7029,13 @@ int main()
     }
     
     std::cout << "Cache Hit Ratio:     " << hit_ratio << "%" << std::endl;
+    std::cout << "Eviction Policy:     " << cache.policyName() << std::endl;
+    std::cout << "Throughput:          " << (serve_seconds > 0 ? g_total_access / serve_seconds : 0.0) << " req/s over " << serve_seconds << " s" << std::endl;
+    std::cout << "----------------------------------------" << std::endl;
+    std::cout << handle_stats(cache);
     std::cout << "========================================" << std::endl;
 
     std::cout << "[INFO] Shutdown complete. " << std::endl;
-    return 0;
+    // Lost writes make the exit status say so.
+    return g_writeback.dropped() > 0 ? 1 : 0;
 }
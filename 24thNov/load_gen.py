@@ -12,7 +12,7 @@ TEST_DURATION = 30 # Set to 60 for final report
 CLIENT_COUNTS = [1, 2, 4, 8, 16, 32, 40, 45, 50]
 
 # Valid Options
-WORKLOADS = ["GET_POPULAR", "GET_ALL", "PUT_ALL", "GET_PUT_MIX"]
+WORKLOADS = ["GET_POPULAR", "GET_ALL", "PUT_ALL", "GET_PUT_MIX", "SCAN_HOT"]
 CONN_MODES = ["KEEP_ALIVE", "CLOSE"]
 
 # ================= HELPER FUNCTIONS =================
@@ -34,6 +34,14 @@ def generate_payload(mode, conn_header):
         heavy_val = "X" * 512 # Heavy payload
         return f"GET /set?key={key}&value={heavy_val} {header}"
             
+    elif mode == "SCAN_HOT":
+        # Half popular keys, half one-off keys from the full space
+        if random.random() < 0.5:
+            key = random.randint(1, 50)
+        else:
+            key = random.randint(1, 10000000)
+        return f"GET /get?key={key} {header}"
+
     elif mode == "GET_PUT_MIX":
         key = random.randint(1, 10000000)
         val = f"mix_{random.randint(1,1024)}"
@@ -150,7 +158,7 @@ if __name__ == "__main__":
     
     if len(sys.argv) != 3:
         print("\nERROR: Usage: python3 load_gen.py <WORKLOAD> <CONNECTION>")
-        print("Workloads:   GET_POPULAR, GET_ALL, PUT_ALL")
+        print("Workloads:   GET_POPULAR, GET_ALL, PUT_ALL, SCAN_HOT")
         print("Connection:  KEEP_ALIVE, CLOSE")
         sys.exit(1)
     
@@ -166,7 +174,7 @@ if __name__ == "__main__":
     print(f"Connection: {conn_mode}")
     
     # Only warmup for Persistent + CPU Bound test
-    if target_mode == "GET_POPULAR" :
+    if target_mode in ("GET_POPULAR", "SCAN_HOT"):
         print("   [Warmup] Pre-loading keys...")
         try:
             s = socket.socket(); s.connect((HOST, PORT))
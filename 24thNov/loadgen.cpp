@@ -4,6 +4,7 @@
 #include <chrono>
 #include <string>
 #include <cstring>
+#include <algorithm>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -40,6 +41,12 @@ string generatePayload(const string& mode, const string& connHeader, unsigned in
         string val(512, 'X');
         return "GET /set?key=" + to_string(key) + "&value=" + val + " " + header;
     }
+    if (mode == "SCAN_HOT") {
+        // Half the requests go to the popular keys, the other half are one-off keys from the full space.
+        if (simpleRand(seed) % 2 == 0)
+            return "GET /get?key=" + to_string(simpleRand(seed) % POPULAR_RANGE) + " " + header;
+        return "GET /get?key=" + to_string(key) + " " + header;
+    }
     if (mode == "GET_PUT_MIX") {
         int r = simpleRand(seed) % 100;
 
@@ -53,8 +60,33 @@ string generatePayload(const string& mode, const string& connHeader, unsigned in
     return "";
 }
 
+// ================= RESPONSE READER =================
+// Reads until `count` complete responses (framed by Content-Length) have arrived; leftovers stay in `pending`.
+bool readResponses(int sockfd, int count, string& pending) {
+    char buffer[65536];
+    while (count > 0) {
+        size_t headerEnd = pending.find("\r\n\r\n");
+        if (headerEnd != string::npos) {
+            size_t clPos = pending.find("Content-Length: ");
+            size_t total = headerEnd + 4;
+            if (clPos != string::npos && clPos < headerEnd) total += strtoul(pending.c_str() + clPos + 16, nullptr, 10);
+            if (pending.size() >= total) {
+                pending.erase(0, total);
+                count--;
+                continue;
+            }
+        }
+        ssize_t n = recv(sockfd, buffer, sizeof(buffer), 0);
+        if (n <= 0) return false;
+        pending.append(buffer, n);
+    }
+    return true;
+}
+
 // ================= WORKER (KEEP-ALIVE) =================
-void workerKeepAlive(const string& mode, int duration,
+// With pipeline > 1 each round sends that many requests back to back before reading their responses;
+// every request in the round is counted with the round's latency.
+void workerKeepAlive(const string& mode, int duration, int pipeline,
                      long long& reqOut, double& latencyOut)
 {
     int sockfd = socket(AF_INET, SOCK_STREAM, 0);
@@ -74,6 +106,7 @@ void workerKeepAlive(const string& mode, int duration,
 
     long long reqCount = 0;
     double latencySum = 0;
+    string pending;
 
     auto start = chrono::high_resolution_clock::now();
 
@@ -81,6 +114,20 @@ void workerKeepAlive(const string& mode, int duration,
         auto now = chrono::high_resolution_clock::now();
         if (chrono::duration<double>(now - start).count() >= duration) break;
 
+        if (pipeline > 1) {
+            string payload;
+            for (int i = 0; i < pipeline; i++) payload += generatePayload(mode, "keep-alive", seed);
+
+            auto t0 = chrono::high_resolution_clock::now();
+            send(sockfd, payload.c_str(), payload.size(), 0);
+            if (!readResponses(sockfd, pipeline, pending)) break;
+            auto t1 = chrono::high_resolution_clock::now();
+
+            reqCount += pipeline;
+            latencySum += pipeline * chrono::duration<double>(t1 - t0).count();
+            continue;
+        }
+
         string payload = generatePayload(mode, "keep-alive", seed);
 
         auto t0 = chrono::high_resolution_clock::now();
@@ -149,21 +196,24 @@ void workerShort(const string& mode, int duration,
 
 // ================= MAIN =================
 int main(int argc, char* argv[]) {
-    if (argc != 4) {
-        cout << "Usage: ./loadgen <WORKLOAD> <CONN> <CLIENTS>\n";
-        cout << "WORKLOAD: GET_POPULAR | GET_ALL | PUT_ALL | GET_PUT_MIX\n";
+    if (argc != 4 && argc != 5) {
+        cout << "Usage: ./loadgen <WORKLOAD> <CONN> <CLIENTS> [PIPELINE]\n";
+        cout << "WORKLOAD: GET_POPULAR | GET_ALL | PUT_ALL | GET_PUT_MIX | SCAN_HOT\n";
         cout << "CONN: KEEP_ALIVE | CLOSE\n";
+        cout << "PIPELINE: requests in flight per KEEP_ALIVE client (default 1)\n";
         return 1;
     }
 
     string mode = argv[1];
     string conn = argv[2];
     int numClients = stoi(argv[3]);
+    int pipeline = argc == 5 ? max(1, stoi(argv[4])) : 1;
 
     cout << "Running benchmark:\n";
     cout << "  Workload: " << mode << "\n";
     cout << "  Connection: " << conn << "\n";
-    cout << "  Clients: " << numClients << "\n\n";
+    cout << "  Clients: " << numClients << "\n";
+    cout << "  Pipeline: " << pipeline << "\n\n";
 
     vector<long long> reqs(numClients, 0);
     vector<double> lats(numClients, 0.0);
@@ -172,7 +222,7 @@ int main(int argc, char* argv[]) {
 
     for (int i = 0; i < numClients; i++) {
         if (conn == "KEEP_ALIVE")
-            threads.emplace_back(workerKeepAlive, mode, TEST_DURATION,
+            threads.emplace_back(workerKeepAlive, mode, TEST_DURATION, pipeline,
                                  ref(reqs[i]), ref(lats[i]));
         else
             threads.emplace_back(workerShort, mode, TEST_DURATION,